@@ -0,0 +1,57 @@
+// Host stand-in for src/framebuffer.c: the same pixel access functions on
+// an in-memory SCREEN_WIDTH x SCREEN_HEIGHT surface instead of GPU memory.
+#include "framebuffer.h"
+#include "memops.h"
+
+static uint32_t surface[SCREEN_WIDTH * SCREEN_HEIGHT];
+
+static framebuffer_t fb = {
+    .width = SCREEN_WIDTH,
+    .height = SCREEN_HEIGHT,
+    .pitch = SCREEN_WIDTH * 4,
+    .buffer = surface,
+    .size = sizeof(surface)
+};
+
+int framebuffer_init(void) {
+    return 0;
+}
+
+framebuffer_t* framebuffer_get(void) {
+    return &fb;
+}
+
+void framebuffer_put_pixel(int x, int y, uint32_t color) {
+    if (x >= 0 && x < (int)fb.width && y >= 0 && y < (int)fb.height) {
+        uint32_t* pixel = fb.buffer + (y * fb.width + x);
+        *pixel = color;
+    }
+}
+
+uint32_t framebuffer_get_pixel(int x, int y) {
+    if (x >= 0 && x < (int)fb.width && y >= 0 && y < (int)fb.height) {
+        uint32_t* pixel = fb.buffer + (y * fb.width + x);
+        return *pixel;
+    }
+    return 0;
+}
+
+void framebuffer_clear(uint32_t color) {
+    for (uint32_t i = 0; i < fb.width * fb.height; i++) {
+        fb.buffer[i] = color;
+    }
+}
+
+void framebuffer_mark_dirty(int x, int y, int width, int height) {
+    (void)x;
+    (void)y;
+    (void)width;
+    (void)height;
+}
+
+// C stand-in for the ARM routine in src/memops.s
+void memset32(uint32_t* dst, uint32_t value, uint32_t count) {
+    while (count--) {
+        *dst++ = value;
+    }
+}
@@ -0,0 +1,214 @@
+// Host microbenchmarks for src/graphics.c.
+//
+// Each benchmark draws into the in-memory surface from framebuffer_host.c
+// until at least --min-time has elapsed, repeated --runs times. The fastest
+// run is the headline number (least disturbed by the host), the median is
+// reported alongside it. Results go to stdout (or --json FILE) as JSON, a table
+// goes to stderr. The surface checksum after a fixed number of calls lets
+// tools/bench_compare.py catch optimizations that change the output.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "graphics.h"
+
+#define DEFAULT_MIN_TIME_MS 200
+#define DEFAULT_RUNS        5
+#define MAX_RUNS            15
+#define CHECKSUM_CALLS      16
+
+typedef struct {
+    const char* name;
+    void (*draw)(uint32_t i);
+} benchmark_t;
+
+typedef struct {
+    double ns_per_call;
+    double ns_median;
+    double mpixels_per_s;
+    uint32_t pixels_per_call;
+    uint64_t iterations;
+    uint32_t checksum;
+} result_t;
+
+// Vary the color per call so nothing can be skipped as redundant
+static uint32_t color_for(uint32_t i) {
+    return 0xFF000000 | ((i * 0x9E3779B1u) & 0x00FFFFFF) | 0x00010101;
+}
+
+static void bench_clear(uint32_t i)          { graphics_clear_screen(color_for(i)); }
+static void bench_rect_cell(uint32_t i)      { graphics_draw_rect(80 + (i & 31) * 16, 80, 15, 15, color_for(i)); }
+static void bench_rect_100(uint32_t i)       { graphics_draw_rect(100 + (i & 63), 100, 100, 100, color_for(i)); }
+static void bench_rect_grid(uint32_t i)      { graphics_draw_rect(80, 80, 640, 480, color_for(i)); }
+static void bench_outline_grid(uint32_t i)   { graphics_draw_rect_outline(78, 78, 644, 484, color_for(i)); }
+static void bench_line_horizontal(uint32_t i){ graphics_draw_line(0, 300, 799, 300, color_for(i)); }
+static void bench_line_vertical(uint32_t i)  { graphics_draw_line(400, 0, 400, 599, color_for(i)); }
+static void bench_line_diagonal(uint32_t i)  { graphics_draw_line(100, 0, 699, 599, color_for(i)); }
+static void bench_line_shallow(uint32_t i)   { graphics_draw_line(0, 200, 799, 400, color_for(i)); }
+static void bench_line_steep(uint32_t i)     { graphics_draw_line(300, 0, 450, 599, color_for(i)); }
+static void bench_circle_small(uint32_t i)   { graphics_draw_circle(400, 300, 8, color_for(i)); }
+static void bench_circle_large(uint32_t i)   { graphics_draw_circle(400, 300, 250, color_for(i)); }
+static void bench_char(uint32_t i)           { graphics_draw_char('A' + (i % 26), 10, 10, color_for(i)); }
+static void bench_text(uint32_t i)           { graphics_draw_text("GPIO: 2=UP 3=DOWN 4=LEFT 17=RIGHT", 10, 30, color_for(i)); }
+
+static const benchmark_t benchmarks[] = {
+    { "clear",            bench_clear },
+    { "rect_15x15",       bench_rect_cell },
+    { "rect_100x100",     bench_rect_100 },
+    { "rect_640x480",     bench_rect_grid },
+    { "outline_644x484",  bench_outline_grid },
+    { "line_horizontal",  bench_line_horizontal },
+    { "line_vertical",    bench_line_vertical },
+    { "line_diagonal",    bench_line_diagonal },
+    { "line_shallow",     bench_line_shallow },
+    { "line_steep",       bench_line_steep },
+    { "circle_r8",        bench_circle_small },
+    { "circle_r250",      bench_circle_large },
+    { "char",             bench_char },
+    { "text_33",          bench_text },
+};
+
+#define BENCHMARK_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint32_t surface_hash(void) {
+    framebuffer_t* fb = framebuffer_get();
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < fb->width * fb->height; i++) {
+        hash = (hash ^ fb->buffer[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Pixels one call writes, measured rather than assumed: draw once on a
+// zeroed surface and count what changed
+static uint32_t measure_pixels(const benchmark_t* bench) {
+    framebuffer_t* fb = framebuffer_get();
+    uint32_t count = 0;
+    
+    memset(fb->buffer, 0, fb->width * fb->height * sizeof(uint32_t));
+    bench->draw(0);
+    for (uint32_t i = 0; i < fb->width * fb->height; i++) {
+        if (fb->buffer[i]) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static uint32_t measure_checksum(const benchmark_t* bench) {
+    framebuffer_t* fb = framebuffer_get();
+    memset(fb->buffer, 0, fb->width * fb->height * sizeof(uint32_t));
+    for (uint32_t i = 0; i < CHECKSUM_CALLS; i++) {
+        bench->draw(i);
+    }
+    return surface_hash();
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void run_benchmark(const benchmark_t* bench, uint64_t min_time_ns, int runs, result_t* result) {
+    double ns_per_call[MAX_RUNS];
+    uint64_t iterations = 1;
+    
+    result->pixels_per_call = measure_pixels(bench);
+    result->checksum = measure_checksum(bench);
+    
+    // Calibrate: double the batch until one batch takes min_time_ns
+    while (1) {
+        uint64_t start = now_ns();
+        for (uint64_t i = 0; i < iterations; i++) {
+            bench->draw((uint32_t)i);
+        }
+        if (now_ns() - start >= min_time_ns || iterations >= (1ull << 40)) break;
+        iterations *= 2;
+    }
+    
+    for (int run = 0; run < runs; run++) {
+        uint64_t start = now_ns();
+        for (uint64_t i = 0; i < iterations; i++) {
+            bench->draw((uint32_t)i);
+        }
+        ns_per_call[run] = (double)(now_ns() - start) / iterations;
+    }
+    
+    qsort(ns_per_call, runs, sizeof(double), compare_double);
+    result->ns_per_call = ns_per_call[0];
+    result->ns_median = ns_per_call[runs / 2];
+    result->mpixels_per_s = result->pixels_per_call * 1000.0 / result->ns_per_call;
+    result->iterations = iterations;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--json FILE] [--filter SUBSTRING] [--min-time MS] [--runs N]\n", program);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    const char* json_path = 0;
+    const char* filter = 0;
+    uint64_t min_time_ns = DEFAULT_MIN_TIME_MS * 1000000ull;
+    int runs = DEFAULT_RUNS;
+    
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--json") && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (!strcmp(argv[i], "--min-time") && i + 1 < argc) {
+            min_time_ns = strtoull(argv[++i], 0, 10) * 1000000ull;
+        } else if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+            if (runs < 1 || runs > MAX_RUNS) usage(argv[0]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    
+    FILE* out = stdout;
+    if (json_path) {
+        out = fopen(json_path, "w");
+        if (!out) {
+            perror(json_path);
+            return 1;
+        }
+    }
+    
+    framebuffer_init();
+    fprintf(out, "{\n  \"suite\": \"graphics\",\n  \"surface\": \"%dx%d\",\n  \"runs\": %d,\n  \"results\": [",
+            SCREEN_WIDTH, SCREEN_HEIGHT, runs);
+    fprintf(stderr, "%-18s %12s %10s %10s %10s\n", "benchmark", "ns/call", "Mpix/s", "pix/call", "checksum");
+    
+    int first = 1;
+    for (size_t i = 0; i < BENCHMARK_COUNT; i++) {
+        const benchmark_t* bench = &benchmarks[i];
+        if (filter && !strstr(bench->name, filter)) continue;
+        
+        result_t result;
+        run_benchmark(bench, min_time_ns, runs, &result);
+        
+        fprintf(stderr, "%-18s %12.1f %10.1f %10u 0x%08x\n", bench->name, result.ns_per_call,
+                result.mpixels_per_s, result.pixels_per_call, result.checksum);
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"ns_per_call\": %.2f, \"mpixels_per_s\": %.2f, "
+                "\"ns_median\": %.2f, \"pixels_per_call\": %u, \"iterations\": %llu, \"checksum\": \"0x%08x\"}",
+                first ? "" : ",", bench->name, result.ns_per_call, result.mpixels_per_s, result.ns_median,
+                result.pixels_per_call, (unsigned long long)result.iterations, result.checksum);
+        first = 0;
+    }
+    
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
@@ -1,4 +1,5 @@
 .section .text.boot
+.fpu neon
 
 .global _start
 
@@ -15,16 +16,26 @@ _start:
     // Set up stack pointer before BSS (grows downward)
     ldr sp, =__stack_start
 
-    // Clear BSS section
+    // Clear BSS section, 32 bytes per store (linker.ld aligns both ends)
     ldr r0, =__bss_start
     ldr r1, =__bss_end
     mov r2, #0
+    mov r3, #0
+    mov r4, #0
+    mov r5, #0
+    mov r6, #0
+    mov r7, #0
+    mov r8, #0
+    mov r9, #0
 clear_bss:
     cmp r0, r1
-    bge clear_bss_done
-    str r2, [r0], #4
-    b clear_bss
-clear_bss_done:
+    stmlo r0!, {r2-r9}
+    blo clear_bss
+
+    // Set up IRQ mode stack (banked sp), then return to SVC mode
+    cps #0x12                   // IRQ mode
+    ldr sp, =__irq_stack_top
+    cps #0x13                   // SVC mode
 
     // Disable caches and MMU
     mrc p15, 0, r0, c1, c0, 0   // Read System Control Register
@@ -38,6 +49,9 @@ clear_bss_done:
     orr r0, r0, #0x300000       // Enable CP10 and CP11
     orr r0, r0, #0xC00000       // Enable CP10 and CP11 in secure mode
     mcr p15, 0, r0, c1, c0, 2   // Write Coprocessor Access Control Register
+    isb
+    mov r0, #0x40000000         // FPEXC.EN: NEON code (e.g. src/blit.s) traps without it
+    vmsr fpexc, r0
 
     // Enable interrupts in CPSR
     cpsie if
@@ -0,0 +1,211 @@
+#include "bcache.h"
+#include "emmc.h"
+#include "memory.h"
+#include "memops.h"
+#include "timer.h"
+
+// Leave the loop this long before the deadline: starting a write costs a
+// command plus one block of PIO
+#define IDLE_MARGIN_US      300
+
+#define NO_ENTRY            (-1)
+
+typedef struct {
+    uint32_t block;
+    uint8_t valid;
+    uint8_t dirty;
+    uint32_t dirty_seq;     // When it became dirty; write-back order
+    uint32_t last_used;
+    uint8_t* data;
+} bcache_entry_t;
+
+static bcache_entry_t entries[BCACHE_BLOCKS];
+static bcache_stats_t stats;
+static uint32_t use_clock = 0;
+static uint32_t dirty_clock = 0;
+static int writing = NO_ENTRY;     // Entry whose write is in flight
+static int in_idle = 0;            // Synchronous card access is not a stall here
+
+int bcache_init(void) {
+    uint8_t* data = boot_alloc(BCACHE_BLOCKS * EMMC_BLOCK_SIZE);
+    if (data == 0) return -1;
+    
+    for (int i = 0; i < BCACHE_BLOCKS; i++) {
+        entries[i].valid = 0;
+        entries[i].dirty = 0;
+        entries[i].data = data + i * EMMC_BLOCK_SIZE;
+    }
+    return 0;
+}
+
+static int find(uint32_t block) {
+    for (int i = 0; i < BCACHE_BLOCKS; i++) {
+        if (entries[i].valid && entries[i].block == block) return i;
+    }
+    return NO_ENTRY;
+}
+
+static int oldest_dirty(void) {
+    int oldest = NO_ENTRY;
+    for (int i = 0; i < BCACHE_BLOCKS; i++) {
+        if (entries[i].valid && entries[i].dirty &&
+            (oldest == NO_ENTRY || (int32_t)(entries[i].dirty_seq - entries[oldest].dirty_seq) < 0)) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+// Account for the write in flight once the card has finished with it; a
+// failed block is marked dirty again for another attempt
+static int finish_write(int wait) {
+    if (writing == NO_ENTRY) return 0;
+    
+    int result;
+    while ((result = emmc_write_poll()) == EMMC_PENDING && wait) {
+    }
+    if (result == EMMC_PENDING) return -1;
+    
+    if (result == EMMC_ERROR) {
+        stats.errors++;
+        if (!entries[writing].dirty) {
+            entries[writing].dirty = 1;
+            entries[writing].dirty_seq = dirty_clock++;
+        }
+    }
+    writing = NO_ENTRY;
+    return result == EMMC_DONE ? 0 : -1;
+}
+
+static int start_write(int index) {
+    finish_write(1);
+    
+    bcache_entry_t* entry = &entries[index];
+    if (emmc_write_start(entry->block, entry->data) != 0) {
+        stats.errors++;
+        return -1;
+    }
+    // The data is in the controller now: the block may be modified (and
+    // dirtied) again while the card programs it
+    entry->dirty = 0;
+    writing = index;
+    stats.writes++;
+    return 0;
+}
+
+// Pick a slot for a new block: the least recently used clean one, else
+// write the oldest dirty block out first
+static int claim(void) {
+    int victim = NO_ENTRY;
+    for (int i = 0; i < BCACHE_BLOCKS; i++) {
+        if (!entries[i].valid) return i;
+        if (!entries[i].dirty && i != writing &&
+            (victim == NO_ENTRY || entries[i].last_used < entries[victim].last_used)) {
+            victim = i;
+        }
+    }
+    if (victim != NO_ENTRY) return victim;
+    
+    int index = oldest_dirty();
+    if (!in_idle) stats.stalls++;
+    if (start_write(index) != 0 || finish_write(1) != 0) return NO_ENTRY;
+    return index;
+}
+
+static uint8_t* lookup(uint32_t block, int fill) {
+    if (!emmc_is_ready()) return 0;
+    
+    int index = find(block);
+    if (index != NO_ENTRY) {
+        stats.hits++;
+    } else {
+        stats.misses++;
+        index = claim();
+        if (index == NO_ENTRY) return 0;
+        
+        entries[index].valid = 0;
+        if (fill) {
+            if (!in_idle) stats.stalls++;
+            finish_write(1); // Collect its result before the read waits on it
+            if (emmc_read(block, entries[index].data, 1) != 0) {
+                stats.errors++;
+                return 0;
+            }
+        } else {
+            memset(entries[index].data, 0, EMMC_BLOCK_SIZE);
+        }
+        entries[index].block = block;
+        entries[index].valid = 1;
+        entries[index].dirty = 0;
+    }
+    
+    entries[index].last_used = use_clock++;
+    return entries[index].data;
+}
+
+// Cached copy of a block, read from the card on a miss. Returns 0 on error.
+// The pointer is valid until the next bcache_get*() call.
+uint8_t* bcache_get(uint32_t block) {
+    return lookup(block, 1);
+}
+
+// For blocks that are about to be overwritten completely: no read
+uint8_t* bcache_get_zeroed(uint32_t block) {
+    return lookup(block, 0);
+}
+
+// Schedule a block obtained from bcache_get*() for write-back
+void bcache_mark_dirty(uint32_t block) {
+    int index = find(block);
+    if (index != NO_ENTRY && !entries[index].dirty) {
+        entries[index].dirty = 1;
+        entries[index].dirty_seq = dirty_clock++;
+    }
+}
+
+// Mark the caller as running in idle time (or at boot), where waiting for
+// the card does not hold up a frame
+void bcache_set_idle(int idle) {
+    in_idle = idle;
+}
+
+// Write back dirty blocks until 'deadline' (System Timer, us). Each write
+// is started and then overlapped with the card's programming time; the
+// loop gives up early rather than run past the deadline.
+void bcache_idle(uint32_t deadline) {
+    while ((int32_t)(deadline - timer_get_ticks()) > IDLE_MARGIN_US) {
+        if (writing != NO_ENTRY) {
+            finish_write(0);
+            if (writing != NO_ENTRY) continue; // Card still busy
+        }
+        
+        int index = oldest_dirty();
+        if (index == NO_ENTRY || start_write(index) != 0) break;
+    }
+}
+
+// Write everything back and wait for the card. Returns -1 on any error.
+int bcache_sync(void) {
+    int result = 0;
+    int index;
+    while ((index = oldest_dirty()) != NO_ENTRY) {
+        if (start_write(index) != 0 || finish_write(1) != 0) {
+            result = -1;
+            break;
+        }
+    }
+    if (finish_write(1) != 0) result = -1;
+    return result;
+}
+
+uint32_t bcache_dirty_count(void) {
+    uint32_t count = 0;
+    for (int i = 0; i < BCACHE_BLOCKS; i++) {
+        count += entries[i].valid && entries[i].dirty;
+    }
+    return count;
+}
+
+const bcache_stats_t* bcache_get_stats(void) {
+    return &stats;
+}
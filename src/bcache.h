@@ -0,0 +1,33 @@
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include "kernel.h"
+
+// Write-behind cache of SD card blocks. Readers and writers work on the
+// cached copy; modified blocks are written back by bcache_idle() in the
+// main loop's spare time, in the order they were first modified. Any card
+// access made outside idle time (see bcache_set_idle()) is one the frame
+// waits for, and is counted as a stall.
+
+#define BCACHE_BLOCKS       16
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t writes;
+    uint32_t stalls;        // Reads and make-room writes waited for outside idle
+    uint32_t errors;
+} bcache_stats_t;
+
+// Function declarations
+int bcache_init(void);
+uint8_t* bcache_get(uint32_t block);
+uint8_t* bcache_get_zeroed(uint32_t block);
+void bcache_mark_dirty(uint32_t block);
+void bcache_set_idle(int idle);
+void bcache_idle(uint32_t deadline);
+int bcache_sync(void);
+uint32_t bcache_dirty_count(void);
+const bcache_stats_t* bcache_get_stats(void);
+
+#endif
@@ -0,0 +1,362 @@
+#include "bench.h"
+#include "graphics.h"
+#include "framebuffer.h"
+#include "snake.h"
+#include "timer.h"
+#include "uart.h"
+#include "pmu.h"
+#include "memory.h"
+#include "memops.h"
+#include "particles.h"
+#include "blend.h"
+
+#define BENCH_ROUNDS    3       // Best of, to skip warm-up and interrupt noise
+#define SNAKE_STEPS     32      // Steps per layout, well inside the safe run
+#define PARTICLE_FRAMES 16      // Frames per burst, well inside its lifetime
+
+#define GPLEV0          (GPIO_BASE + 0x34)
+#define GPCLR0          (GPIO_BASE + 0x28)
+#define TIMER_CLO       (TIMER_BASE + 0x04)
+
+#define RAM_FILL_WORDS  (64 * 1024 / 4)
+
+typedef struct {
+    const char* name;
+    void (*run)(uint32_t iterations);
+    uint32_t iterations;
+    uint32_t pixels;            // Per iteration, 0 if not a pixel benchmark
+} bench_t;
+
+static uint32_t* ram_buffer = 0;
+static volatile uint32_t sink;
+
+static void bench_empty(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        __asm__ volatile ("" ::: "memory");
+    }
+}
+
+static void bench_clear(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        graphics_clear_screen(i & 1 ? COLOR_BLACK : COLOR_DARK_GRAY);
+    }
+}
+
+static void bench_rect_cell(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        graphics_draw_rect(80 + (i & 31) * 16, 80, 15, 15, COLOR_GREEN);
+    }
+}
+
+static void bench_rect_100(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        graphics_draw_rect(100, 100, 100, 100, i & 1 ? COLOR_RED : COLOR_BLUE);
+    }
+}
+
+static void bench_blend_rect(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        blend_rect(100, 100, 100, 100, i & 1 ? 0x80FF0000 : 0x800000FF);
+    }
+}
+
+// The RAM buffer as a 128x128 image with whatever alpha its words have;
+// the kernel's cost does not depend on the values
+static void bench_blend_image(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        blend_image(100, 100, 128, 128, ram_buffer, 128);
+    }
+}
+
+static void bench_ram_fill(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        for (uint32_t j = 0; j < RAM_FILL_WORDS; j++) {
+            ram_buffer[j] = i;
+        }
+    }
+}
+
+static void bench_memset(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        memset32(ram_buffer, i, RAM_FILL_WORDS);
+    }
+}
+
+static void bench_memcpy(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        memcpy(ram_buffer, ram_buffer + RAM_FILL_WORDS / 2, RAM_FILL_WORDS * 2);
+    }
+}
+
+static void bench_memcpy_neon(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        memcpy_neon(ram_buffer, ram_buffer + RAM_FILL_WORDS / 2, RAM_FILL_WORDS * 2);
+    }
+}
+
+// Present a fully dirty shadow: the dirty-tile flush at its worst case
+static void bench_flush(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        framebuffer_mark_dirty(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+        framebuffer_flush();
+    }
+}
+
+static void bench_char(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        graphics_draw_char('A' + (i & 15), 10, 10, COLOR_WHITE);
+    }
+}
+
+static void bench_text(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        graphics_draw_text("GPIO: 2=UP 3=DOWN 4=LEFT 17=RIGHT", 10, 30, COLOR_CYAN);
+    }
+}
+
+static void bench_mmio_read(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        sink = mmio_read(GPLEV0);
+    }
+}
+
+// Same register inside one peripheral_enter()/exit() pair
+static void bench_mmio_read_relaxed(uint32_t n) {
+    peripheral_enter();
+    for (uint32_t i = 0; i < n; i++) {
+        sink = mmio_read_relaxed(GPLEV0);
+    }
+    peripheral_exit();
+}
+
+static void bench_mmio_write(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        mmio_write(GPCLR0, 0); // Writing zero clears nothing
+    }
+}
+
+static void bench_timer_read(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        sink = timer_get_ticks();
+    }
+}
+
+static void bench_timer_read_64(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        sink = (uint32_t)timer_get_ticks_64();
+    }
+}
+
+static void bench_pmu_read(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        sink = pmu_cycles();
+    }
+}
+
+static const bench_t benchmarks[] = {
+    { "loop overhead",   bench_empty,         100000, 0 },
+    { "clear 800x600",   bench_clear,         4,      SCREEN_WIDTH * SCREEN_HEIGHT },
+    { "rect 15x15",      bench_rect_cell,     2000,   15 * 15 },
+    { "rect 100x100",    bench_rect_100,      50,     100 * 100 },
+    { "blend 100x100",   bench_blend_rect,    50,     100 * 100 },
+    { "blend img 128x128", bench_blend_image, 20,     128 * 128 },
+    { "flush 800x600",   bench_flush,         4,      SCREEN_WIDTH * SCREEN_HEIGHT },
+    { "ram fill 64KB",   bench_ram_fill,      20,     RAM_FILL_WORDS },  // Words as pixels
+    { "memset32 64KB",   bench_memset,        20,     RAM_FILL_WORDS },
+    { "memcpy 32KB",     bench_memcpy,        20,     RAM_FILL_WORDS / 2 },
+    { "memcpy_neon 32KB", bench_memcpy_neon,  20,     RAM_FILL_WORDS / 2 },
+    { "char 8x8",        bench_char,          2000,   0 },
+    { "text 33 chars",   bench_text,          200,    0 },
+    { "mmio read",       bench_mmio_read,     10000,  0 },
+    { "mmio read relaxed", bench_mmio_read_relaxed, 10000, 0 },
+    { "mmio write",      bench_mmio_write,    10000,  0 },
+    { "timer read",      bench_timer_read,    10000,  0 },
+    { "timer read 64",   bench_timer_read_64, 10000,  0 },
+    { "pmu cycle read",  bench_pmu_read,      10000,  0 },
+};
+
+#define BENCH_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+static void print_padded(const char* text, int width) {
+    int length = 0;
+    while (text[length]) {
+        length++;
+    }
+    uart_puts(text);
+    while (length++ < width) {
+        uart_putc(' ');
+    }
+}
+
+static void print_number(uint32_t value, int width) {
+    char digits[11];
+    int count = 0;
+    
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    
+    for (int i = count; i < width; i++) {
+        uart_putc(' ');
+    }
+    while (count) {
+        uart_putc(digits[--count]);
+    }
+}
+
+// One table row: cycles and nanoseconds per iteration, and pixel rate
+static void print_row(const char* name, uint32_t iterations, uint32_t cycles,
+                      uint32_t micros, uint32_t pixels) {
+    print_padded(name, 18);
+    print_number(iterations, 8);
+    print_number(cycles / iterations, 12);
+    
+    // ns per iteration without overflowing: scale down large totals first
+    uint32_t ns = micros < 4000000 ? micros * 1000 / iterations : micros / iterations * 1000;
+    print_number(ns, 12);
+    
+    if (pixels && micros) {
+        // pixels/us == Mpixels/s
+        print_number(pixels * iterations / micros, 10);
+    } else {
+        print_padded("", 10);
+    }
+    uart_puts("\n");
+}
+
+// Best of BENCH_ROUNDS for cycles and for time
+static void measure(void (*run)(uint32_t), uint32_t iterations, uint32_t* cycles, uint32_t* micros) {
+    *cycles = 0xFFFFFFFF;
+    *micros = 0xFFFFFFFF;
+    
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        uint32_t start_us = timer_get_ticks();
+        uint32_t start = pmu_cycles();
+        run(iterations);
+        uint32_t elapsed = pmu_cycles() - start;
+        uint32_t elapsed_us = timer_get_ticks() - start_us;
+        
+        if (elapsed < *cycles) *cycles = elapsed;
+        if (elapsed_us < *micros) *micros = elapsed_us;
+    }
+}
+
+// Full snake_update() steps (movement, wall and self collision) at a given
+// length; only the steps are timed, the relayout between runs is not
+static void bench_snake(int length) {
+    uint32_t best_cycles = 0xFFFFFFFF;
+    uint32_t best_us = 0xFFFFFFFF;
+    
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        snake_bench_layout(length);
+        
+        uint32_t start_us = timer_get_ticks();
+        uint32_t start = pmu_cycles();
+        for (int step = 0; step < SNAKE_STEPS; step++) {
+            snake_update();
+        }
+        uint32_t cycles = pmu_cycles() - start;
+        uint32_t micros = timer_get_ticks() - start_us;
+        
+        if (cycles < best_cycles) best_cycles = cycles;
+        if (micros < best_us) best_us = micros;
+    }
+    
+    static const char prefix[] = "snake update ";
+    char name[24];
+    char* end = name;
+    for (const char* p = prefix; *p; p++) {
+        *end++ = *p;
+    }
+    
+    char digits[6];
+    int count = 0;
+    do {
+        digits[count++] = '0' + length % 10;
+        length /= 10;
+    } while (length);
+    while (count) {
+        *end++ = digits[--count];
+    }
+    *end = '\0';
+    
+    print_row(name, SNAKE_STEPS, best_cycles, best_us, 0);
+}
+
+// A full pool of particles: one simulation step, erase and draw per frame,
+// without the budget cutting it short. Compare with "clear 800x600".
+static void bench_particles(void) {
+    uint32_t best_cycles = 0xFFFFFFFF;
+    uint32_t best_us = 0xFFFFFFFF;
+    framebuffer_t* fb = framebuffer_get();
+    
+    if (particles_init() != 0) {
+        uart_puts("particles: out of memory\n");
+        return;
+    }
+    particles_set_budget(1000000);
+    
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        uint32_t now = timer_get_ticks();
+        particles_clear();
+        particles_erase();
+        particles_update(now);
+        particles_burst(fb->width / 2, fb->height / 2, PARTICLES_CAPACITY, COLOR_YELLOW, 128);
+        
+        uint32_t start_us = timer_get_ticks();
+        uint32_t start = pmu_cycles();
+        for (int frame = 0; frame < PARTICLE_FRAMES; frame++) {
+            now += PARTICLES_STEP_US;
+            particles_update(now);
+            particles_erase();
+            particles_draw();
+        }
+        uint32_t cycles = pmu_cycles() - start;
+        uint32_t micros = timer_get_ticks() - start_us;
+        
+        if (cycles < best_cycles) best_cycles = cycles;
+        if (micros < best_us) best_us = micros;
+    }
+    
+    particles_clear();
+    particles_erase();
+    print_row("particles 4096", PARTICLE_FRAMES, best_cycles, best_us, 0);
+}
+
+void bench_run(void) {
+    static const int snake_lengths[] = { 3, 64, 256, 1024 };
+    
+    ram_buffer = boot_alloc(RAM_FILL_WORDS * sizeof(uint32_t));
+    if (ram_buffer == 0) {
+        panic("Out of memory for benchmarks");
+    }
+    
+    // Calibrate the cycle counter against the 1MHz System Timer
+    uint32_t start_us = timer_get_ticks();
+    uint32_t start = pmu_cycles();
+    timer_sleep(100);
+    uint32_t mhz = (pmu_cycles() - start) / (timer_get_ticks() - start_us);
+    
+    uart_puts("\nPolisnake on-target benchmarks (best of ");
+    uart_dec(BENCH_ROUNDS);
+    uart_puts(" rounds, CPU ~");
+    uart_dec(mhz);
+    uart_puts(" MHz)\n");
+    print_padded("benchmark", 18);
+    uart_puts("   iters  cycles/iter     ns/iter  Mpix/s\n");
+    
+    for (uint32_t i = 0; i < BENCH_COUNT; i++) {
+        uint32_t cycles, micros;
+        measure(benchmarks[i].run, benchmarks[i].iterations, &cycles, &micros);
+        print_row(benchmarks[i].name, benchmarks[i].iterations, cycles, micros, benchmarks[i].pixels);
+    }
+    
+    for (uint32_t i = 0; i < sizeof(snake_lengths) / sizeof(snake_lengths[0]); i++) {
+        bench_snake(snake_lengths[i]);
+    }
+    bench_particles();
+    
+    uart_puts("Benchmarks done\n");
+    uart_flush();
+}
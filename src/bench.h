@@ -0,0 +1,12 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "kernel.h"
+
+// On-target microbenchmarks, built into the alternative kernel produced by
+// "make bench" (BENCH_KERNEL). kernel_main() runs them instead of the game.
+
+// Function declarations
+void bench_run(void);
+
+#endif
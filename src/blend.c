@@ -0,0 +1,79 @@
+#include "blend.h"
+#include "framebuffer.h"
+#include "graphics.h"
+
+// Pixels left over after the NEON kernels' groups of eight
+#define NEON_MASK   7
+
+// One pixel with the same arithmetic as the NEON kernels
+static inline uint32_t blend_pixel(uint32_t dst, uint32_t src) {
+    uint32_t a = src >> 24;
+    uint32_t out = 0;
+    
+    src |= 0xFF000000;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t t = ((src >> shift) & 0xFF) * a + ((dst >> shift) & 0xFF) * (255 - a);
+        out |= ((t + ((t + 128) >> 8) + 128) >> 8) << shift;
+    }
+    return out;
+}
+
+// Clip a rectangle to the framebuffer. Returns 0 if nothing is left;
+// *skip_x and *skip_y are how much was cut from the left and top.
+static int clip(int* x, int* y, int* width, int* height, int* skip_x, int* skip_y) {
+    framebuffer_t* fb = framebuffer_get();
+    
+    *skip_x = *x < 0 ? -*x : 0;
+    *skip_y = *y < 0 ? -*y : 0;
+    *x += *skip_x;
+    *y += *skip_y;
+    *width -= *skip_x;
+    *height -= *skip_y;
+    if (*x + *width > (int)fb->width) *width = fb->width - *x;
+    if (*y + *height > (int)fb->height) *height = fb->height - *y;
+    return *width > 0 && *height > 0;
+}
+
+// Fill a rectangle with 'color' blended by its alpha (make_color_argb())
+void blend_rect(int x, int y, int width, int height, uint32_t color) {
+    uint32_t alpha = color >> 24;
+    int skip_x, skip_y;
+    
+    if (alpha == 0) return;
+    if (alpha == 0xFF) {
+        graphics_draw_rect(x, y, width, height, color);
+        return;
+    }
+    if (!clip(&x, &y, &width, &height, &skip_x, &skip_y)) return;
+    
+    framebuffer_t* fb = framebuffer_get();
+    int bulk = width & ~NEON_MASK;
+    for (int row = 0; row < height; row++) {
+        uint32_t* dst = fb->buffer + (y + row) * fb->width + x;
+        blend_fill_neon(dst, bulk, color);
+        for (int i = bulk; i < width; i++) {
+            dst[i] = blend_pixel(dst[i], color);
+        }
+    }
+    framebuffer_mark_dirty(x, y, width, height);
+}
+
+// Blend an ARGB image with per-pixel alpha; 'stride' is in pixels
+void blend_image(int x, int y, int width, int height, const uint32_t* image, uint32_t stride) {
+    int skip_x, skip_y;
+    
+    if (!clip(&x, &y, &width, &height, &skip_x, &skip_y)) return;
+    image += skip_y * stride + skip_x;
+    
+    framebuffer_t* fb = framebuffer_get();
+    int bulk = width & ~NEON_MASK;
+    for (int row = 0; row < height; row++) {
+        uint32_t* dst = fb->buffer + (y + row) * fb->width + x;
+        const uint32_t* src = image + row * stride;
+        blend_copy_neon(dst, src, bulk);
+        for (int i = bulk; i < width; i++) {
+            dst[i] = blend_pixel(dst[i], src[i]);
+        }
+    }
+    framebuffer_mark_dirty(x, y, width, height);
+}
@@ -0,0 +1,21 @@
+#ifndef BLEND_H
+#define BLEND_H
+
+#include "kernel.h"
+
+// Translucent drawing: source-over blending of ARGB colors and images into
+// the framebuffer, eight pixels per NEON iteration (src/blend.s). Only the
+// pixels inside the clipped rectangle are read and written, and the
+// rectangle is marked dirty. Blending onto pixels that were blended before
+// compounds, so overlays either draw once over a static picture or restore
+// what was underneath first (see frameprof_erase_hud()).
+
+// Function declarations
+void blend_rect(int x, int y, int width, int height, uint32_t color);
+void blend_image(int x, int y, int width, int height, const uint32_t* image, uint32_t stride);
+
+// NEON kernels (src/blend.s); count is a multiple of 8
+void blend_fill_neon(uint32_t* dst, uint32_t count, uint32_t color);
+void blend_copy_neon(uint32_t* dst, const uint32_t* src, uint32_t count);
+
+#endif
@@ -0,0 +1,81 @@
+.syntax unified
+.section .text
+.fpu neon
+
+// Source-over blending of ARGB pixels, eight per iteration:
+//     out = (src * a + dst * (255 - a)) / 255, rounded, per channel
+// The division is exact: t / 255 == (t + ((t + 128) >> 8) + 128) >> 8 for
+// every sum of two 8x8 products, which is one vrshr and one vraddhn. The
+// source alpha channel is blended as 255, so an opaque destination stays
+// opaque. Counts are in pixels and must be multiples of 8 (src/blend.c
+// does the rest); pointers need only 4-byte alignment. Uses only
+// caller-saved q0-q3 and q8-q15, main loop only like all NEON code here.
+
+// void blend_fill_neon(uint32_t* dst, uint32_t count, uint32_t color)
+// A constant color: the source term is computed once, so each pair of
+// pixels costs one multiply-accumulate.
+.global blend_fill_neon
+blend_fill_neon:
+    lsrs r1, r1, #3
+    bxeq lr
+    lsr r3, r2, #24
+    orr r2, r2, #0xFF000000
+    vdup.8 d28, r3              // a
+    vmvn d29, d28               // 255 - a
+    vdup.32 d30, r2
+    vmull.u8 q12, d30, d28      // src * a for two pixels
+1:
+    vld1.32 {d0-d3}, [r0]
+    vmov q8, q12
+    vmov q9, q12
+    vmov q10, q12
+    vmov q11, q12
+    vmlal.u8 q8, d0, d29
+    vmlal.u8 q9, d1, d29
+    vmlal.u8 q10, d2, d29
+    vmlal.u8 q11, d3, d29
+    vrshr.u16 q0, q8, #8
+    vrshr.u16 q1, q9, #8
+    vrshr.u16 q2, q10, #8
+    vrshr.u16 q3, q11, #8
+    vraddhn.u16 d0, q8, q0
+    vraddhn.u16 d1, q9, q1
+    vraddhn.u16 d2, q10, q2
+    vraddhn.u16 d3, q11, q3
+    vst1.32 {d0-d3}, [r0]!
+    subs r1, r1, #1
+    bne 1b
+    bx lr
+
+// void blend_copy_neon(uint32_t* dst, const uint32_t* src, uint32_t count)
+// Per-pixel alpha: vld4 splits eight pixels into b, g, r, a planes so the
+// source alpha multiplies whole planes, and vst4 interleaves them back.
+.global blend_copy_neon
+blend_copy_neon:
+    lsrs r2, r2, #3
+    bxeq lr
+    vmov.i8 d31, #0xFF
+1:
+    vld4.8 {d0-d3}, [r1]!       // Source planes b, g, r, a
+    vld4.8 {d4-d7}, [r0]        // Destination planes
+    vmvn d30, d3                // 255 - a
+    vmull.u8 q8, d0, d3
+    vmull.u8 q9, d1, d3
+    vmull.u8 q10, d2, d3
+    vmull.u8 q11, d31, d3
+    vmlal.u8 q8, d4, d30
+    vmlal.u8 q9, d5, d30
+    vmlal.u8 q10, d6, d30
+    vmlal.u8 q11, d7, d30
+    vrshr.u16 q12, q8, #8
+    vrshr.u16 q13, q9, #8
+    vrshr.u16 q14, q10, #8
+    vrshr.u16 q0, q11, #8
+    vraddhn.u16 d4, q8, q12
+    vraddhn.u16 d5, q9, q13
+    vraddhn.u16 d6, q10, q14
+    vraddhn.u16 d7, q11, q0
+    vst4.8 {d4-d7}, [r0]!
+    subs r2, r2, #1
+    bne 1b
+    bx lr
@@ -0,0 +1,30 @@
+.section .text
+.fpu neon
+
+// void blit_tile_32(uint32_t* dst, const uint32_t* src, uint32_t rows,
+//                   uint32_t dst_stride, uint32_t src_stride)
+// Copy a 32-pixel (128-byte) wide column of 'rows' rows; strides in bytes.
+// Each row is two 64-byte NEON bursts, so stores to the non-cacheable
+// framebuffer leave the write buffer as full lines. Uses only the
+// caller-saved d0-d7 and d16-d23.
+.global blit_tile_32
+blit_tile_32:
+    push {r4, lr}
+    ldr r4, [sp, #8]            // src_stride
+    cmp r2, #0
+    beq 2f
+    sub r3, r3, #96             // The post-incremented part of each row
+    sub r4, r4, #96
+1:
+    vld1.32 {d0-d3}, [r1]!
+    vld1.32 {d4-d7}, [r1]!
+    vld1.32 {d16-d19}, [r1]!
+    vld1.32 {d20-d23}, [r1], r4
+    vst1.32 {d0-d3}, [r0]!
+    vst1.32 {d4-d7}, [r0]!
+    vst1.32 {d16-d19}, [r0]!
+    vst1.32 {d20-d23}, [r0], r3
+    subs r2, r2, #1
+    bne 1b
+2:
+    pop {r4, pc}
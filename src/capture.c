@@ -0,0 +1,175 @@
+#include "capture.h"
+#include "framebuffer.h"
+#include "telemetry.h"
+#include "timer.h"
+#include "uart.h"
+#include "memory.h"
+#include "memops.h"
+
+#define CAPTURE_RUN_BYTES   5
+
+// Worst case tile: every pixel is its own run
+#define CAPTURE_TILE_PAYLOAD (sizeof(capture_tile_t) + \
+    CAPTURE_TILE_SIZE * CAPTURE_TILE_SIZE * CAPTURE_RUN_BYTES)
+
+// The screen as the host last received it, allocated from the boot arena
+// on first use and sized to the actual framebuffer. Tiles are compared
+// pixel for pixel against it, so no change is ever missed.
+static uint32_t* previous_frame = 0;
+static int previous_valid = 0;
+
+static volatile int capture_pending = 0;
+static volatile int capture_keyframe = 0;
+static uint32_t capture_interval = 0;
+static uint32_t frames_since_capture = 0;
+static uint32_t frame_id = 0;
+
+static int tile_changed(const uint32_t* base, const uint32_t* previous, uint32_t stride,
+                        int w, int h) {
+    for (int row = 0; row < h; row++) {
+        const uint32_t* pixel = base + row * stride;
+        const uint32_t* old = previous + row * stride;
+        for (int col = 0; col < w; col++) {
+            if (pixel[col] != old[col]) return 1;
+        }
+    }
+    return 0;
+}
+
+static void save_tile(uint32_t* previous, const uint32_t* base, uint32_t stride, int w, int h) {
+    for (int row = 0; row < h; row++) {
+        memcpy(previous + row * stride, base + row * stride, w * sizeof(uint32_t));
+    }
+}
+
+// Run-length encode a tile in row-major order; runs continue across rows
+static uint32_t encode_tile(uint8_t* out, const uint32_t* base, uint32_t stride, int w, int h) {
+    uint32_t pos = 0;
+    uint32_t run_color = base[0];
+    uint32_t run_length = 0;
+    
+    for (int row = 0; row < h; row++) {
+        const uint32_t* pixel = base + row * stride;
+        for (int col = 0; col < w; col++) {
+            if (pixel[col] == run_color && run_length < 256) {
+                run_length++;
+                continue;
+            }
+            
+            out[pos++] = run_length - 1;
+            out[pos++] = run_color & 0xFF;
+            out[pos++] = (run_color >> 8) & 0xFF;
+            out[pos++] = (run_color >> 16) & 0xFF;
+            out[pos++] = run_color >> 24;
+            run_color = pixel[col];
+            run_length = 1;
+        }
+    }
+    
+    out[pos++] = run_length - 1;
+    out[pos++] = run_color & 0xFF;
+    out[pos++] = (run_color >> 8) & 0xFF;
+    out[pos++] = (run_color >> 16) & 0xFF;
+    out[pos++] = run_color >> 24;
+    return pos;
+}
+
+// Ask for a capture at the end of the current frame. Safe from IRQ context.
+void capture_request(int keyframe) {
+    capture_keyframe |= keyframe;
+    capture_pending = 1;
+}
+
+// Capture every 'frames' frames (0 disables continuous capture)
+void capture_set_interval(uint32_t frames) {
+    capture_interval = frames;
+    frames_since_capture = 0;
+}
+
+// Run a pending capture. Call from the main loop between drawing and the
+// next update so the snapshot is consistent; the game is stalled while
+// the changed tiles are streamed out.
+void capture_service(void) {
+    if (capture_interval && ++frames_since_capture >= capture_interval) {
+        frames_since_capture = 0;
+        capture_pending = 1;
+    }
+    if (!capture_pending) return;
+    
+    framebuffer_t* fb = framebuffer_get();
+    if (fb->buffer == 0) return;
+    
+    int tiles_x = (fb->width + CAPTURE_TILE_SIZE - 1) / CAPTURE_TILE_SIZE;
+    int tiles_y = (fb->height + CAPTURE_TILE_SIZE - 1) / CAPTURE_TILE_SIZE;
+    if (previous_frame == 0) {
+        previous_frame = boot_alloc(fb->width * fb->height * sizeof(uint32_t));
+    }
+    
+    // Encoded tiles only live until they are sent: frame scratch
+    uint8_t* tile_buffer = frame_alloc(CAPTURE_TILE_PAYLOAD);
+    if (previous_frame == 0 || tile_buffer == 0) {
+        capture_pending = 0;
+        uart_puts("capture: out of memory\n");
+        return;
+    }
+    
+    uint32_t start = timer_get_ticks();
+    int keyframe = capture_keyframe || !previous_valid;
+    capture_pending = 0;
+    capture_keyframe = 0;
+    frame_id++;
+    
+    capture_begin_t begin = {
+        .frame_id = frame_id,
+        .width = fb->width,
+        .height = fb->height,
+        .tile_size = CAPTURE_TILE_SIZE,
+        .keyframe = keyframe
+    };
+    telemetry_send_blocking(TELEMETRY_CAPTURE_BEGIN, &begin, sizeof(begin));
+    
+    uint32_t tiles_sent = 0;
+    uint32_t bytes_sent = 0;
+    int failed = 0;
+    
+    for (int ty = 0; ty < tiles_y; ty++) {
+        for (int tx = 0; tx < tiles_x; tx++) {
+            int x = tx * CAPTURE_TILE_SIZE;
+            int y = ty * CAPTURE_TILE_SIZE;
+            int w = fb->width - x < CAPTURE_TILE_SIZE ? (int)fb->width - x : CAPTURE_TILE_SIZE;
+            int h = fb->height - y < CAPTURE_TILE_SIZE ? (int)fb->height - y : CAPTURE_TILE_SIZE;
+            const uint32_t* base = fb->buffer + y * fb->width + x;
+            
+            // Skip tiles that have not changed since the last capture
+            uint32_t* previous = previous_frame + y * fb->width + x;
+            if (!keyframe && !tile_changed(base, previous, fb->width, w, h)) continue;
+            
+            capture_tile_t* tile = (capture_tile_t*)tile_buffer;
+            tile->x = x;
+            tile->y = y;
+            tile->width = w;
+            tile->height = h;
+            uint32_t size = sizeof(capture_tile_t) +
+                encode_tile(tile_buffer + sizeof(capture_tile_t), base, fb->width, w, h);
+            
+            // The host only has what was sent; a lost tile forces a keyframe
+            if (telemetry_send_blocking(TELEMETRY_CAPTURE_TILE, tile_buffer, size) != 0) {
+                failed = 1;
+                continue;
+            }
+            save_tile(previous, base, fb->width, w, h);
+            tiles_sent++;
+            bytes_sent += size;
+        }
+    }
+    previous_valid = !failed;
+    
+    capture_end_t end = {
+        .frame_id = frame_id,
+        .tiles_sent = tiles_sent,
+        .tiles_total = tiles_x * tiles_y,
+        .bytes_sent = bytes_sent,
+        .duration_us = timer_get_ticks() - start
+    };
+    telemetry_send_blocking(TELEMETRY_CAPTURE_END, &end, sizeof(end));
+}
@@ -0,0 +1,41 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "kernel.h"
+
+// Screen capture over the telemetry channel. The screen is split into
+// tiles; only tiles with any pixel changed since the previous capture are
+// sent, each run-length encoded (see tools/capture.py).
+#define CAPTURE_TILE_SIZE   16
+
+// Wire records (little endian, packed)
+typedef struct __attribute__((packed)) {
+    uint32_t frame_id;
+    uint16_t width;
+    uint16_t height;
+    uint8_t tile_size;
+    uint8_t keyframe;       // 1 if every tile follows
+} capture_begin_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t x;             // Tile origin in pixels
+    uint16_t y;
+    uint8_t width;
+    uint8_t height;
+    // Followed by runs of { uint8_t length - 1; uint32_t color; }
+} capture_tile_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t frame_id;
+    uint16_t tiles_sent;
+    uint16_t tiles_total;
+    uint32_t bytes_sent;
+    uint32_t duration_us;
+} capture_end_t;
+
+// Function declarations
+void capture_request(int keyframe);
+void capture_set_interval(uint32_t frames);
+void capture_service(void);
+
+#endif
@@ -0,0 +1,264 @@
+#include "console.h"
+#include "uart.h"
+
+#define CONSOLE_LINE_MAX    64
+#define CONSOLE_MAX_ARGS    6
+#define CONSOLE_MAX_VARS    24
+#define CONSOLE_MAX_CMDS    24
+
+typedef struct {
+    const char* name;
+    volatile int* value;
+    int min;
+    int max;
+    console_var_changed_t changed;
+} console_var_t;
+
+typedef struct {
+    const char* name;
+    console_command_t handler;
+    const char* help;
+} console_cmd_t;
+
+static console_var_t vars[CONSOLE_MAX_VARS];
+static int var_count = 0;
+static console_cmd_t commands[CONSOLE_MAX_CMDS];
+static int command_count = 0;
+
+// Line editing happens in the UART interrupt; a finished line is handed
+// to the main loop through 'pending_line'
+static volatile int command_mode = 0;
+static char edit_line[CONSOLE_LINE_MAX];
+static int edit_length = 0;
+static char pending_line[CONSOLE_LINE_MAX];
+static volatile int line_pending = 0;
+
+static int str_equal(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+// Parse a decimal (optionally negative) integer; returns 0 on success
+static int parse_int(const char* str, int* out) {
+    int sign = 1;
+    int value = 0;
+    
+    if (*str == '-') {
+        sign = -1;
+        str++;
+    }
+    if (*str == '\0') return -1;
+    
+    while (*str) {
+        if (*str < '0' || *str > '9') return -1;
+        value = value * 10 + (*str++ - '0');
+    }
+    
+    *out = sign * value;
+    return 0;
+}
+
+static void print_int(int value) {
+    if (value < 0) {
+        uart_putc('-');
+        value = -value;
+    }
+    uart_dec(value);
+}
+
+static console_var_t* find_var(const char* name) {
+    for (int i = 0; i < var_count; i++) {
+        if (str_equal(vars[i].name, name)) return &vars[i];
+    }
+    return 0;
+}
+
+static void print_var(const console_var_t* var) {
+    uart_puts(var->name);
+    uart_puts(" = ");
+    print_int(*var->value);
+    uart_puts(" (");
+    print_int(var->min);
+    uart_puts("..");
+    print_int(var->max);
+    uart_puts(")\n");
+}
+
+static void cmd_help(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    
+    for (int i = 0; i < command_count; i++) {
+        uart_puts("  ");
+        uart_puts(commands[i].name);
+        uart_puts(" - ");
+        uart_puts(commands[i].help);
+        uart_puts("\n");
+    }
+}
+
+static void cmd_get(int argc, char** argv) {
+    if (argc < 2) {
+        for (int i = 0; i < var_count; i++) {
+            print_var(&vars[i]);
+        }
+        return;
+    }
+    
+    console_var_t* var = find_var(argv[1]);
+    if (!var) {
+        uart_puts("Unknown variable\n");
+        return;
+    }
+    print_var(var);
+}
+
+static void cmd_set(int argc, char** argv) {
+    int value;
+    
+    if (argc != 3) {
+        uart_puts("Usage: set <name> <value>\n");
+        return;
+    }
+    
+    console_var_t* var = find_var(argv[1]);
+    if (!var) {
+        uart_puts("Unknown variable\n");
+        return;
+    }
+    if (parse_int(argv[2], &value) != 0 || value < var->min || value > var->max) {
+        uart_puts("Value out of range\n");
+        return;
+    }
+    
+    *var->value = value;
+    if (var->changed) {
+        var->changed(value);
+    }
+    print_var(var);
+}
+
+static void cmd_exit(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    
+    command_mode = 0;
+    uart_puts("Back to game input\n");
+}
+
+// Split the line in place and run the matching command
+static void execute_line(char* line) {
+    char* argv[CONSOLE_MAX_ARGS];
+    int argc = 0;
+    
+    while (*line && argc < CONSOLE_MAX_ARGS) {
+        while (*line == ' ') {
+            *line++ = '\0';
+        }
+        if (*line == '\0') break;
+        
+        argv[argc++] = line;
+        while (*line && *line != ' ') {
+            line++;
+        }
+    }
+    if (argc == 0) return;
+    
+    for (int i = 0; i < command_count; i++) {
+        if (str_equal(commands[i].name, argv[0])) {
+            commands[i].handler(argc, argv);
+            return;
+        }
+    }
+    uart_puts("Unknown command, try 'help'\n");
+}
+
+void console_init(void) {
+    console_register_command("help", cmd_help, "list commands");
+    console_register_command("get", cmd_get, "[name] - show tunable variables");
+    console_register_command("set", cmd_set, "<name> <value> - change a variable");
+    console_register_command("exit", cmd_exit, "leave command mode (or ESC)");
+}
+
+// Feed one received character. Returns 1 if the console consumed it,
+// 0 if it should go to the game. Runs in the UART interrupt.
+int console_handle_char(char c) {
+    if (c == CONSOLE_KEY_ESCAPE) {
+        command_mode = !command_mode;
+        edit_length = 0;
+        uart_puts(command_mode ? "\nCommand mode ('help', ESC to leave)\n> " : "\nBack to game input\n");
+        return 1;
+    }
+    if (!command_mode) return 0;
+    
+    if (c == '\r' || c == '\n') {
+        uart_puts("\n");
+        if (line_pending) {
+            uart_puts("Busy\n> ");
+        } else {
+            for (int i = 0; i < edit_length; i++) {
+                pending_line[i] = edit_line[i];
+            }
+            pending_line[edit_length] = '\0';
+            line_pending = 1;
+        }
+        edit_length = 0;
+    } else if (c == 0x08 || c == 0x7F) {
+        if (edit_length > 0) {
+            edit_length--;
+            uart_puts("\b \b");
+        }
+    } else if (c >= 32 && c < 127 && edit_length < CONSOLE_LINE_MAX - 1) {
+        edit_line[edit_length++] = c;
+        uart_putc(c);
+    }
+    return 1;
+}
+
+// Execute a pending command line. Call from the main loop.
+void console_poll(void) {
+    if (!line_pending) return;
+    
+    execute_line(pending_line);
+    line_pending = 0;
+    
+    if (command_mode) {
+        uart_puts("> ");
+    }
+}
+
+void console_register_var(const char* name, volatile int* value, int min, int max,
+                          console_var_changed_t changed) {
+    if (var_count >= CONSOLE_MAX_VARS) return;
+    
+    vars[var_count].name = name;
+    vars[var_count].value = value;
+    vars[var_count].min = min;
+    vars[var_count].max = max;
+    vars[var_count].changed = changed;
+    var_count++;
+}
+
+void console_register_command(const char* name, console_command_t handler, const char* help) {
+    if (command_count >= CONSOLE_MAX_CMDS) return;
+    
+    commands[command_count].name = name;
+    commands[command_count].handler = handler;
+    commands[command_count].help = help;
+    command_count++;
+}
+
+// Argument helpers for command handlers
+int console_arg_is(const char* arg, const char* word) {
+    return str_equal(arg, word);
+}
+
+// Positive decimal argument, 0 if missing or malformed
+uint32_t console_arg_number(const char* arg) {
+    int value;
+    if (parse_int(arg, &value) != 0 || value < 0) return 0;
+    return value;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include "kernel.h"
+
+// Runtime command console on the UART. ESC switches between game input and
+// command mode; a complete line is executed from the main loop by
+// console_poll(), never in interrupt context.
+
+#define CONSOLE_KEY_ESCAPE  0x1B
+
+// Called after a variable changes (may be NULL)
+typedef void (*console_var_changed_t)(int value);
+
+// Command handler: argv[0] is the command name
+typedef void (*console_command_t)(int argc, char** argv);
+
+// Function declarations
+void console_init(void);
+int console_handle_char(char c);
+void console_poll(void);
+void console_register_var(const char* name, volatile int* value, int min, int max,
+                          console_var_changed_t changed);
+void console_register_command(const char* name, console_command_t handler, const char* help);
+int console_arg_is(const char* arg, const char* word);
+uint32_t console_arg_number(const char* arg);
+
+#endif
@@ -0,0 +1,402 @@
+#include "emmc.h"
+#include "gpio.h"
+#include "mailbox.h"
+#include "timer.h"
+
+// EMMC (SDHCI) registers
+#define EMMC_BASE           (PERIPHERAL_BASE + 0x300000)
+#define EMMC_BLKSIZECNT     (EMMC_BASE + 0x04)
+#define EMMC_ARG1           (EMMC_BASE + 0x08)
+#define EMMC_CMDTM          (EMMC_BASE + 0x0C)
+#define EMMC_RESP0          (EMMC_BASE + 0x10)
+#define EMMC_RESP1          (EMMC_BASE + 0x14)
+#define EMMC_RESP2          (EMMC_BASE + 0x18)
+#define EMMC_RESP3          (EMMC_BASE + 0x1C)
+#define EMMC_DATA           (EMMC_BASE + 0x20)
+#define EMMC_STATUS         (EMMC_BASE + 0x24)
+#define EMMC_CONTROL0       (EMMC_BASE + 0x28)
+#define EMMC_CONTROL1       (EMMC_BASE + 0x2C)
+#define EMMC_INTERRUPT      (EMMC_BASE + 0x30)
+#define EMMC_IRPT_MASK      (EMMC_BASE + 0x34)
+#define EMMC_IRPT_EN        (EMMC_BASE + 0x38)
+#define EMMC_CONTROL2       (EMMC_BASE + 0x3C)
+
+// CMDTM fields
+#define CMD_INDEX(n)        ((n) << 24)
+#define CMD_ISDATA          (1 << 21)
+#define CMD_IXCHK_EN        (1 << 20)
+#define CMD_CRCCHK_EN       (1 << 19)
+#define CMD_RSPNS_136       (1 << 16)
+#define CMD_RSPNS_48        (2 << 16)
+#define CMD_RSPNS_48_BUSY   (3 << 16)
+#define CMD_TM_BLKCNT_EN    (1 << 1)
+#define CMD_TM_AUTO_CMD12   (1 << 2)
+#define CMD_TM_DAT_READ     (1 << 4)
+#define CMD_TM_MULTI_BLOCK  (1 << 5)
+
+#define RESP_R1             (CMD_RSPNS_48 | CMD_CRCCHK_EN | CMD_IXCHK_EN)
+#define RESP_R1B            (CMD_RSPNS_48_BUSY | CMD_CRCCHK_EN | CMD_IXCHK_EN)
+#define RESP_R2             (CMD_RSPNS_136 | CMD_CRCCHK_EN)
+#define RESP_R3             CMD_RSPNS_48    // OCR: no CRC or index
+
+// STATUS bits
+#define STATUS_CMD_INHIBIT  (1 << 0)
+#define STATUS_DAT_INHIBIT  (1 << 1)
+
+// CONTROL0 bits
+#define CONTROL0_DWIDTH4    (1 << 1)
+
+// CONTROL1 bits
+#define CONTROL1_CLK_INTLEN (1 << 0)
+#define CONTROL1_CLK_STABLE (1 << 1)
+#define CONTROL1_CLK_EN     (1 << 2)
+#define CONTROL1_CLK_MASK   0xFFE0
+#define CONTROL1_TOUNIT_MAX (0xE << 16)
+#define CONTROL1_SRST_HC    (1 << 24)
+#define CONTROL1_SRST_CMD   (1 << 25)
+#define CONTROL1_SRST_DATA  (1 << 26)
+
+// INTERRUPT bits
+#define INT_CMD_DONE        (1 << 0)
+#define INT_DATA_DONE       (1 << 1)
+#define INT_WRITE_READY     (1 << 4)
+#define INT_READ_READY      (1 << 5)
+#define INT_ERROR_MASK      0xFFFF8000
+#define INT_ALL             0xFFFFFFFF
+
+// SD commands (ACMDs follow CMD55)
+#define SD_GO_IDLE          0
+#define SD_ALL_SEND_CID     2
+#define SD_SEND_RCA         3
+#define SD_SELECT_CARD      7
+#define SD_SEND_IF_COND     8
+#define SD_SEND_CSD         9
+#define SD_SET_BLOCKLEN     16
+#define SD_READ_SINGLE      17
+#define SD_READ_MULTIPLE    18
+#define SD_WRITE_SINGLE     24
+#define SD_APP_CMD          55
+#define SD_APP_SET_BUS_WIDTH    6
+#define SD_APP_SEND_OP_COND     41
+
+#define IF_COND_CHECK       0x000001AA      // 2.7-3.6V, check pattern 0xAA
+#define OCR_VOLTAGES        0x00FF8000
+#define OCR_HCS             (1u << 30)      // Host supports / card is SDHC
+#define OCR_POWERED_UP      (1u << 31)
+
+#define CLOCK_IDENTIFY_HZ   400000
+#define CLOCK_TRANSFER_HZ   25000000
+#define CLOCK_DEFAULT_HZ    200000000       // If the firmware won't say
+
+#define EMMC_TIMEOUT_US     500000
+#define EMMC_WRITE_TIMEOUT_US   1000000
+#define OP_COND_RETRIES     100
+
+// GPIO 48-53 carry the card on ALT3
+#define SD_PIN_FIRST        48
+#define SD_PIN_LAST         53
+
+typedef struct {
+    int ready;
+    int high_capacity;          // Block addressed (SDHC/SDXC)
+    uint32_t rca;
+    uint32_t blocks;
+    uint32_t base_clock;
+    int write_pending;
+    uint32_t write_started;
+} emmc_state_t;
+
+static emmc_state_t card;
+
+// Wait until all bits of 'mask' are set in INTERRUPT (or an error is).
+// Clears the bits that were waited for.
+static int wait_interrupt(uint32_t mask, uint32_t timeout_us) {
+    uint32_t start = timer_get_ticks();
+    uint32_t status;
+    
+    peripheral_enter();
+    while (((status = mmio_read_relaxed(EMMC_INTERRUPT)) & (mask | INT_ERROR_MASK)) != mask) {
+        if ((status & INT_ERROR_MASK) || timer_get_ticks() - start > timeout_us) {
+            mmio_write_relaxed(EMMC_INTERRUPT, status);
+            peripheral_exit();
+            return -1;
+        }
+    }
+    mmio_write_relaxed(EMMC_INTERRUPT, mask);
+    peripheral_exit();
+    return 0;
+}
+
+static int wait_status_clear(uint32_t mask) {
+    uint32_t start = timer_get_ticks();
+    while (mmio_read(EMMC_STATUS) & mask) {
+        if (timer_get_ticks() - start > EMMC_TIMEOUT_US) return -1;
+    }
+    return 0;
+}
+
+// Reset one of the controller's state machines (SRST_* bit)
+static int reset_line(uint32_t bit) {
+    mmio_write(EMMC_CONTROL1, mmio_read(EMMC_CONTROL1) | bit);
+    uint32_t start = timer_get_ticks();
+    while (mmio_read(EMMC_CONTROL1) & bit) {
+        if (timer_get_ticks() - start > EMMC_TIMEOUT_US) return -1;
+    }
+    return 0;
+}
+
+// Issue a command and wait for its response. Data commands must have set
+// BLKSIZECNT first; on error the command line is reset for the next try.
+static int send_command(uint32_t index, uint32_t flags, uint32_t arg) {
+    uint32_t inhibit = STATUS_CMD_INHIBIT | ((flags & CMD_ISDATA) ? STATUS_DAT_INHIBIT : 0);
+    if (wait_status_clear(inhibit) != 0) return -1;
+    
+    peripheral_enter();
+    mmio_write_relaxed(EMMC_INTERRUPT, INT_ALL);
+    mmio_write_relaxed(EMMC_ARG1, arg);
+    mmio_write_relaxed(EMMC_CMDTM, CMD_INDEX(index) | flags);
+    peripheral_exit();
+    
+    if (wait_interrupt(INT_CMD_DONE, EMMC_TIMEOUT_US) != 0) {
+        reset_line(CONTROL1_SRST_CMD);
+        return -1;
+    }
+    return 0;
+}
+
+static int send_app_command(uint32_t index, uint32_t flags, uint32_t arg) {
+    if (send_command(SD_APP_CMD, RESP_R1, card.rca << 16) != 0) return -1;
+    return send_command(index, flags, arg);
+}
+
+// SD clock = base / (2 * divisor), 10-bit divisor (SDHCI 3.0)
+static int set_clock(uint32_t hz) {
+    uint32_t divisor = (card.base_clock + 2 * hz - 1) / (2 * hz);
+    if (divisor > 0x3FF) divisor = 0x3FF;
+    
+    if (wait_status_clear(STATUS_CMD_INHIBIT | STATUS_DAT_INHIBIT) != 0) return -1;
+    
+    uint32_t control1 = mmio_read(EMMC_CONTROL1) & ~(CONTROL1_CLK_EN | CONTROL1_CLK_MASK);
+    mmio_write(EMMC_CONTROL1, control1);
+    timer_sleep_us(10);
+    
+    control1 |= ((divisor & 0xFF) << 8) | ((divisor >> 8) << 6) | CONTROL1_CLK_INTLEN;
+    mmio_write(EMMC_CONTROL1, control1);
+    
+    uint32_t start = timer_get_ticks();
+    while (!(mmio_read(EMMC_CONTROL1) & CONTROL1_CLK_STABLE)) {
+        if (timer_get_ticks() - start > EMMC_TIMEOUT_US) return -1;
+    }
+    mmio_write(EMMC_CONTROL1, control1 | CONTROL1_CLK_EN);
+    timer_sleep_us(10);
+    return 0;
+}
+
+static uint32_t query_base_clock(void) {
+    static mailbox_batch_t batch;
+    
+    mailbox_batch_begin(&batch);
+    uint32_t* clock = mailbox_batch_add(&batch, MAILBOX_TAG_GET_CLOCK_RATE, 8);
+    clock[0] = MAILBOX_CLOCK_EMMC;
+    if (mailbox_call(&batch) != 0 || !mailbox_tag_ok(clock) || clock[1] == 0) {
+        return CLOCK_DEFAULT_HZ;
+    }
+    return clock[1];
+}
+
+// Card size from the CSD (R2 responses arrive without the CRC byte, so
+// CSD bit n is bit n - 8 of RESP0..3)
+static uint32_t csd_block_count(void) {
+    uint32_t resp1 = mmio_read(EMMC_RESP1);
+    uint32_t resp2 = mmio_read(EMMC_RESP2);
+    uint32_t resp3 = mmio_read(EMMC_RESP3);
+    
+    if (((resp3 >> 22) & 3) == 1) {
+        // CSD 2.0: (C_SIZE + 1) * 512KB
+        uint32_t c_size = (resp1 >> 8) & 0x3FFFFF;
+        return (c_size + 1) * 1024;
+    }
+    
+    uint32_t c_size = ((resp1 >> 22) & 0x3FF) | ((resp2 & 3) << 10);
+    uint32_t mult = (resp1 >> 7) & 7;
+    uint32_t block_len = (resp2 >> 8) & 0xF;
+    return ((c_size + 1) << (mult + 2)) << block_len >> 9;
+}
+
+// Reset the controller and bring the card to the transfer state with a
+// 4-bit bus at 25MHz. Returns 0 on success, -1 if there is no usable card.
+int emmc_init(void) {
+    card.ready = 0;
+    card.rca = 0;
+    card.write_pending = 0;
+    
+    for (int pin = SD_PIN_FIRST; pin <= SD_PIN_LAST; pin++) {
+        gpio_set_function(pin, GPIO_FUNC_ALT3);
+        gpio_set_pull(pin, pin == SD_PIN_FIRST ? GPIO_PULL_NONE : GPIO_PULL_UP);
+    }
+    card.base_clock = query_base_clock();
+    
+    mmio_write(EMMC_CONTROL0, 0);
+    mmio_write(EMMC_CONTROL2, 0);
+    if (reset_line(CONTROL1_SRST_HC) != 0) return -1;
+    
+    mmio_write(EMMC_CONTROL1, CONTROL1_TOUNIT_MAX);
+    if (set_clock(CLOCK_IDENTIFY_HZ) != 0) return -1;
+    
+    // Status bits only, no interrupt to the ARM: everything is polled
+    mmio_write(EMMC_IRPT_EN, 0);
+    mmio_write(EMMC_IRPT_MASK, INT_ALL);
+    mmio_write(EMMC_INTERRUPT, INT_ALL);
+    
+    if (send_command(SD_GO_IDLE, 0, 0) != 0) return -1;
+    
+    // Version 2 cards echo the check pattern; version 1 cards ignore CMD8
+    uint32_t ocr_request = OCR_VOLTAGES;
+    if (send_command(SD_SEND_IF_COND, RESP_R1, IF_COND_CHECK) == 0) {
+        if ((mmio_read(EMMC_RESP0) & 0xFFF) != IF_COND_CHECK) return -1;
+        ocr_request |= OCR_HCS;
+    }
+    
+    uint32_t ocr = 0;
+    for (int i = 0; i < OP_COND_RETRIES && !(ocr & OCR_POWERED_UP); i++) {
+        if (send_app_command(SD_APP_SEND_OP_COND, RESP_R3, ocr_request) != 0) return -1;
+        ocr = mmio_read(EMMC_RESP0);
+        if (!(ocr & OCR_POWERED_UP)) timer_sleep(10);
+    }
+    if (!(ocr & OCR_POWERED_UP)) return -1;
+    card.high_capacity = (ocr & OCR_HCS) != 0;
+    
+    if (send_command(SD_ALL_SEND_CID, RESP_R2, 0) != 0) return -1;
+    if (send_command(SD_SEND_RCA, RESP_R1, 0) != 0) return -1;
+    card.rca = mmio_read(EMMC_RESP0) >> 16;
+    
+    if (send_command(SD_SEND_CSD, RESP_R2, card.rca << 16) != 0) return -1;
+    card.blocks = csd_block_count();
+    
+    if (send_command(SD_SELECT_CARD, RESP_R1B, card.rca << 16) != 0) return -1;
+    if (set_clock(CLOCK_TRANSFER_HZ) != 0) return -1;
+    
+    // Every SD memory card supports the 4-bit bus
+    if (send_app_command(SD_APP_SET_BUS_WIDTH, RESP_R1, 2) == 0) {
+        mmio_write(EMMC_CONTROL0, mmio_read(EMMC_CONTROL0) | CONTROL0_DWIDTH4);
+    }
+    if (!card.high_capacity &&
+        send_command(SD_SET_BLOCKLEN, RESP_R1, EMMC_BLOCK_SIZE) != 0) {
+        return -1;
+    }
+    
+    card.ready = 1;
+    return 0;
+}
+
+int emmc_is_ready(void) {
+    return card.ready;
+}
+
+uint32_t emmc_get_block_count(void) {
+    return card.ready ? card.blocks : 0;
+}
+
+// Standard capacity cards take byte addresses
+static uint32_t block_address(uint32_t block) {
+    return card.high_capacity ? block : block * EMMC_BLOCK_SIZE;
+}
+
+// Finish any write in flight; the data lines are busy until then
+static int wait_write(void) {
+    uint32_t start = timer_get_ticks();
+    int result;
+    while ((result = emmc_write_poll()) == EMMC_PENDING) {
+        if (timer_get_ticks() - start > EMMC_WRITE_TIMEOUT_US) return -1;
+    }
+    return result;
+}
+
+// Blocking read of 'count' consecutive blocks into a word-aligned buffer
+int emmc_read(uint32_t block, void* buffer, uint32_t count) {
+    if (!card.ready || count == 0 || wait_write() != 0) return -1;
+    
+    uint32_t* words = buffer;
+    uint32_t command = count > 1 ? SD_READ_MULTIPLE : SD_READ_SINGLE;
+    uint32_t flags = RESP_R1 | CMD_ISDATA | CMD_TM_DAT_READ;
+    if (count > 1) {
+        flags |= CMD_TM_BLKCNT_EN | CMD_TM_AUTO_CMD12 | CMD_TM_MULTI_BLOCK;
+    }
+    
+    mmio_write(EMMC_BLKSIZECNT, (count << 16) | EMMC_BLOCK_SIZE);
+    if (send_command(command, flags, block_address(block)) != 0) return -1;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        if (wait_interrupt(INT_READ_READY, EMMC_TIMEOUT_US) != 0) {
+            reset_line(CONTROL1_SRST_DATA);
+            return -1;
+        }
+        peripheral_enter();
+        for (uint32_t w = 0; w < EMMC_BLOCK_SIZE / 4; w++) {
+            *words++ = mmio_read_relaxed(EMMC_DATA);
+        }
+        peripheral_exit();
+    }
+    
+    if (wait_interrupt(INT_DATA_DONE, EMMC_TIMEOUT_US) != 0) {
+        reset_line(CONTROL1_SRST_DATA);
+        return -1;
+    }
+    return 0;
+}
+
+// Send one block and return without waiting for the card to program it;
+// emmc_write_poll() reports completion
+int emmc_write_start(uint32_t block, const void* buffer) {
+    if (!card.ready || wait_write() != 0) return -1;
+    
+    const uint32_t* words = buffer;
+    mmio_write(EMMC_BLKSIZECNT, (1 << 16) | EMMC_BLOCK_SIZE);
+    if (send_command(SD_WRITE_SINGLE, RESP_R1 | CMD_ISDATA, block_address(block)) != 0) {
+        return -1;
+    }
+    if (wait_interrupt(INT_WRITE_READY, EMMC_TIMEOUT_US) != 0) {
+        reset_line(CONTROL1_SRST_DATA);
+        return -1;
+    }
+    
+    peripheral_enter();
+    for (uint32_t w = 0; w < EMMC_BLOCK_SIZE / 4; w++) {
+        mmio_write_relaxed(EMMC_DATA, *words++);
+    }
+    peripheral_exit();
+    
+    card.write_pending = 1;
+    card.write_started = timer_get_ticks();
+    return 0;
+}
+
+// DATA_DONE of a write also covers the card's busy signal
+int emmc_write_poll(void) {
+    if (!card.write_pending) return EMMC_DONE;
+    
+    uint32_t status = mmio_read(EMMC_INTERRUPT);
+    if (status & INT_ERROR_MASK) {
+        mmio_write(EMMC_INTERRUPT, status);
+        reset_line(CONTROL1_SRST_DATA);
+        card.write_pending = 0;
+        return EMMC_ERROR;
+    }
+    if (status & INT_DATA_DONE) {
+        mmio_write(EMMC_INTERRUPT, INT_DATA_DONE);
+        card.write_pending = 0;
+        return EMMC_DONE;
+    }
+    if (timer_get_ticks() - card.write_started > EMMC_WRITE_TIMEOUT_US) {
+        reset_line(CONTROL1_SRST_DATA);
+        card.write_pending = 0;
+        return EMMC_ERROR;
+    }
+    return EMMC_PENDING;
+}
+
+// Blocking write of one block
+int emmc_write(uint32_t block, const void* buffer) {
+    if (emmc_write_start(block, buffer) != 0) return -1;
+    return wait_write();
+}
@@ -0,0 +1,27 @@
+#ifndef EMMC_H
+#define EMMC_H
+
+#include "kernel.h"
+
+// SD card on the Arasan SDHCI controller ("EMMC"), PIO transfers of
+// 512-byte blocks. Reads block; a write is started with
+// emmc_write_start() and then polled, so the card's programming time
+// (often milliseconds) can overlap with other work.
+
+#define EMMC_BLOCK_SIZE     512
+
+// emmc_write_poll() results
+#define EMMC_DONE           0
+#define EMMC_PENDING        1
+#define EMMC_ERROR          (-1)
+
+// Function declarations
+int emmc_init(void);
+int emmc_is_ready(void);
+uint32_t emmc_get_block_count(void);
+int emmc_read(uint32_t block, void* buffer, uint32_t count);
+int emmc_write_start(uint32_t block, const void* buffer);
+int emmc_write_poll(void);
+int emmc_write(uint32_t block, const void* buffer);
+
+#endif
@@ -0,0 +1,414 @@
+#include "fat.h"
+#include "bcache.h"
+#include "emmc.h"
+#include "memops.h"
+
+#define BLOCK_SIZE          EMMC_BLOCK_SIZE
+
+// Boot sector (BPB) fields
+#define BPB_BYTES_PER_SECTOR    0x0B
+#define BPB_SECTORS_PER_CLUSTER 0x0D
+#define BPB_RESERVED_SECTORS    0x0E
+#define BPB_FAT_COUNT           0x10
+#define BPB_ROOT_ENTRIES        0x11
+#define BPB_TOTAL_SECTORS_32    0x20
+#define BPB_FAT_SIZE_32         0x24
+#define BPB_ROOT_CLUSTER        0x2C
+#define BPB_FSINFO_SECTOR       0x30
+#define BOOT_SIGNATURE          0x1FE
+
+// MBR partition table
+#define MBR_PARTITION_TYPE      0x1C2
+#define MBR_PARTITION_LBA       0x1C6
+#define PARTITION_FAT32_CHS     0x0B
+#define PARTITION_FAT32_LBA     0x0C
+
+// FSInfo sector
+#define FSINFO_LEAD_SIGNATURE   0x000
+#define FSINFO_STRUCT_SIGNATURE 0x1E4
+#define FSINFO_FREE_COUNT       0x1E8
+#define FSINFO_NEXT_FREE        0x1EC
+#define FSINFO_LEAD_MAGIC       0x41615252
+#define FSINFO_STRUCT_MAGIC     0x61417272
+#define FSINFO_UNKNOWN          0xFFFFFFFF
+
+// Directory entries
+#define DIR_ENTRY_SIZE          32
+#define DIR_NAME                0x00
+#define DIR_ATTR                0x0B
+#define DIR_CLUSTER_HIGH        0x14
+#define DIR_DATE                0x18
+#define DIR_CLUSTER_LOW         0x1A
+#define DIR_SIZE                0x1C
+#define DIR_END                 0x00    // First name byte: no more entries
+#define DIR_DELETED             0xE5
+#define ATTR_VOLUME_ID          0x08
+#define ATTR_LONG_NAME          0x0F
+#define ATTR_ARCHIVE            0x20
+#define DATE_1980_01_01         0x0021
+
+// FAT entries
+#define FAT_ENTRY_MASK          0x0FFFFFFF
+#define FAT_END_OF_CHAIN        0x0FFFFFF8
+#define FAT_EOC_MARK            0x0FFFFFFF
+#define FAT_FREE                0
+
+typedef struct {
+    int mounted;
+    uint32_t sectors_per_cluster;
+    uint32_t fat_start;         // First block of the first FAT
+    uint32_t fat_blocks;        // Blocks per FAT
+    uint32_t fat_count;
+    uint32_t data_start;        // Block of cluster 2
+    uint32_t cluster_count;
+    uint32_t root_cluster;
+    uint32_t fsinfo_block;      // 0 if none
+    uint32_t free_hint;         // Where the next free cluster search starts
+    int fsinfo_stale;           // Free count marked unknown already
+} fat_volume_t;
+
+static fat_volume_t volume;
+
+// Little-endian fields at any alignment
+static uint32_t get16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put16(uint8_t* p, uint32_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t value) {
+    put16(p, value);
+    put16(p + 2, value >> 16);
+}
+
+static int is_fat32_boot_sector(const uint8_t* sector) {
+    return get16(sector + BOOT_SIGNATURE) == 0xAA55 &&
+           get16(sector + BPB_BYTES_PER_SECTOR) == BLOCK_SIZE &&
+           sector[BPB_SECTORS_PER_CLUSTER] != 0 &&
+           get16(sector + BPB_ROOT_ENTRIES) == 0 &&
+           get32(sector + BPB_FAT_SIZE_32) != 0;
+}
+
+static uint32_t cluster_block(uint32_t cluster) {
+    return volume.data_start + (cluster - 2) * volume.sectors_per_cluster;
+}
+
+uint32_t fat_cluster_bytes(void) {
+    return volume.sectors_per_cluster * BLOCK_SIZE;
+}
+
+static int valid_cluster(uint32_t cluster) {
+    return cluster >= 2 && cluster < volume.cluster_count + 2;
+}
+
+// Find the volume and read its geometry. Returns 0 on success.
+int fat_mount(void) {
+    volume.mounted = 0;
+    
+    uint8_t* sector = bcache_get(0);
+    if (sector == 0) return -1;
+    
+    uint32_t start = 0;
+    if (!is_fat32_boot_sector(sector)) {
+        uint8_t type = sector[MBR_PARTITION_TYPE];
+        if (get16(sector + BOOT_SIGNATURE) != 0xAA55 ||
+            (type != PARTITION_FAT32_CHS && type != PARTITION_FAT32_LBA)) {
+            return -1;
+        }
+        start = get32(sector + MBR_PARTITION_LBA);
+        sector = bcache_get(start);
+        if (sector == 0 || !is_fat32_boot_sector(sector)) return -1;
+    }
+    
+    volume.sectors_per_cluster = sector[BPB_SECTORS_PER_CLUSTER];
+    volume.fat_start = start + get16(sector + BPB_RESERVED_SECTORS);
+    volume.fat_blocks = get32(sector + BPB_FAT_SIZE_32);
+    volume.fat_count = sector[BPB_FAT_COUNT];
+    volume.data_start = volume.fat_start + volume.fat_count * volume.fat_blocks;
+    volume.root_cluster = get32(sector + BPB_ROOT_CLUSTER);
+    
+    uint32_t fsinfo = get16(sector + BPB_FSINFO_SECTOR);
+    volume.fsinfo_block = (fsinfo != 0 && fsinfo != 0xFFFF) ? start + fsinfo : 0;
+    
+    uint32_t total = get32(sector + BPB_TOTAL_SECTORS_32);
+    if (volume.fat_count == 0 || total < volume.data_start - start) return -1;
+    volume.cluster_count = (total - (volume.data_start - start)) / volume.sectors_per_cluster;
+    
+    // A FAT holds 128 entries per block, two of them reserved
+    if (volume.cluster_count + 2 > volume.fat_blocks * (BLOCK_SIZE / 4)) {
+        volume.cluster_count = volume.fat_blocks * (BLOCK_SIZE / 4) - 2;
+    }
+    if (!valid_cluster(volume.root_cluster)) return -1;
+    
+    // Start the free cluster search where FSInfo says, not at the front of
+    // a FAT that may be full of other files
+    volume.free_hint = 2;
+    if (volume.fsinfo_block) {
+        sector = bcache_get(volume.fsinfo_block);
+        if (sector && get32(sector + FSINFO_LEAD_SIGNATURE) == FSINFO_LEAD_MAGIC &&
+            get32(sector + FSINFO_STRUCT_SIGNATURE) == FSINFO_STRUCT_MAGIC &&
+            valid_cluster(get32(sector + FSINFO_NEXT_FREE))) {
+            volume.free_hint = get32(sector + FSINFO_NEXT_FREE);
+        }
+    }
+    volume.fsinfo_stale = 0;
+    volume.mounted = 1;
+    return 0;
+}
+
+int fat_is_mounted(void) {
+    return volume.mounted;
+}
+
+// Next cluster in a chain; FAT_EOC_MARK on end of chain or error
+static uint32_t fat_get(uint32_t cluster) {
+    uint32_t offset = cluster * 4;
+    uint8_t* sector = bcache_get(volume.fat_start + offset / BLOCK_SIZE);
+    if (sector == 0) return FAT_EOC_MARK;
+    
+    uint32_t next = get32(sector + offset % BLOCK_SIZE) & FAT_ENTRY_MASK;
+    return valid_cluster(next) || next == FAT_FREE ? next : FAT_EOC_MARK;
+}
+
+// Update an entry in every copy of the FAT (the top four bits are reserved)
+static int fat_set(uint32_t cluster, uint32_t value) {
+    uint32_t offset = cluster * 4;
+    for (uint32_t copy = 0; copy < volume.fat_count; copy++) {
+        uint32_t block = volume.fat_start + copy * volume.fat_blocks + offset / BLOCK_SIZE;
+        uint8_t* sector = bcache_get(block);
+        if (sector == 0) return -1;
+        
+        uint8_t* entry = sector + offset % BLOCK_SIZE;
+        put32(entry, (get32(entry) & ~FAT_ENTRY_MASK) | value);
+        bcache_mark_dirty(block);
+    }
+    return 0;
+}
+
+// Keep the FSInfo next-free hint current for the next mount. The free
+// count is not maintained; it is marked unknown, as the spec allows.
+static void update_fsinfo(uint32_t next_free) {
+    if (volume.fsinfo_block == 0) return;
+    
+    uint8_t* sector = bcache_get(volume.fsinfo_block);
+    if (sector == 0) return;
+    if (!volume.fsinfo_stale) {
+        put32(sector + FSINFO_FREE_COUNT, FSINFO_UNKNOWN);
+        volume.fsinfo_stale = 1;
+    }
+    put32(sector + FSINFO_NEXT_FREE, next_free);
+    bcache_mark_dirty(volume.fsinfo_block);
+}
+
+// Take a free cluster, mark it as the end of a chain and link it after
+// 'previous' (0 for a new chain). Returns the cluster or 0 if the disk is full.
+static uint32_t allocate_cluster(uint32_t previous) {
+    for (uint32_t i = 0; i < volume.cluster_count; i++) {
+        uint32_t cluster = 2 + (volume.free_hint - 2 + i) % volume.cluster_count;
+        uint32_t offset = cluster * 4;
+        uint8_t* sector = bcache_get(volume.fat_start + offset / BLOCK_SIZE);
+        if (sector == 0) return 0;
+        if (get32(sector + offset % BLOCK_SIZE) & FAT_ENTRY_MASK) continue;
+        
+        if (fat_set(cluster, FAT_EOC_MARK) != 0) return 0;
+        if (previous && fat_set(previous, cluster) != 0) return 0;
+        volume.free_hint = valid_cluster(cluster + 1) ? cluster + 1 : 2;
+        update_fsinfo(volume.free_hint);
+        return cluster;
+    }
+    return 0;
+}
+
+// "scores.txt" -> "SCORES  TXT"
+static void to_short_name(const char* name, char* out) {
+    memset(out, ' ', 11);
+    int i = 0;
+    while (*name && *name != '.' && i < 8) {
+        char c = *name++;
+        out[i++] = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+    }
+    while (*name && *name != '.') name++;
+    if (*name == '.') name++;
+    for (i = 8; *name && i < 11; i++) {
+        char c = *name++;
+        out[i] = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+    }
+}
+
+// Walk a chain to the cluster that holds byte 'size' - 1 (or the first
+// cluster of an empty file)
+static uint32_t tail_cluster(uint32_t first, uint32_t size) {
+    uint32_t cluster = first;
+    uint32_t count = size ? (size - 1) / fat_cluster_bytes() : 0;
+    for (uint32_t i = 0; i < count && valid_cluster(cluster); i++) {
+        cluster = fat_get(cluster);
+    }
+    return valid_cluster(cluster) ? cluster : 0;
+}
+
+static void load_entry(fat_file_t* file, const uint8_t* entry, uint32_t block, uint32_t offset) {
+    file->first_cluster = (get16(entry + DIR_CLUSTER_HIGH) << 16) | get16(entry + DIR_CLUSTER_LOW);
+    file->size = get32(entry + DIR_SIZE);
+    file->dir_block = block;
+    file->dir_offset = offset;
+    if (!valid_cluster(file->first_cluster)) {
+        file->first_cluster = 0;
+        file->size = 0;
+    }
+    file->last_cluster = file->first_cluster ? tail_cluster(file->first_cluster, file->size) : 0;
+}
+
+// Open a file in the root directory, creating it (empty) if 'create' is
+// set and there is a free entry. Returns 0 on success.
+int fat_open(fat_file_t* file, const char* name, int create) {
+    if (!volume.mounted) return -1;
+    
+    char short_name[11];
+    to_short_name(name, short_name);
+    
+    uint32_t free_block = 0;
+    uint32_t free_offset = 0;
+    uint32_t cluster = volume.root_cluster;
+    
+    while (valid_cluster(cluster)) {
+        for (uint32_t b = 0; b < volume.sectors_per_cluster; b++) {
+            uint32_t block = cluster_block(cluster) + b;
+            for (uint32_t offset = 0; offset < BLOCK_SIZE; offset += DIR_ENTRY_SIZE) {
+                uint8_t* sector = bcache_get(block);
+                if (sector == 0) return -1;
+                uint8_t* entry = sector + offset;
+                
+                if (entry[DIR_NAME] == DIR_END || entry[DIR_NAME] == DIR_DELETED) {
+                    if (free_block == 0) {
+                        free_block = block;
+                        free_offset = offset;
+                    }
+                    if (entry[DIR_NAME] == DIR_END) goto not_found;
+                    continue;
+                }
+                if (entry[DIR_ATTR] == ATTR_LONG_NAME || (entry[DIR_ATTR] & ATTR_VOLUME_ID)) continue;
+                
+                int match = 1;
+                for (int i = 0; i < 11 && match; i++) {
+                    match = entry[DIR_NAME + i] == (uint8_t)short_name[i];
+                }
+                if (match) {
+                    load_entry(file, entry, block, offset);
+                    return 0;
+                }
+            }
+        }
+        cluster = fat_get(cluster);
+    }
+
+not_found:
+    // The root directory is never grown
+    if (!create || free_block == 0) return -1;
+    
+    uint8_t* sector = bcache_get(free_block);
+    if (sector == 0) return -1;
+    uint8_t* entry = sector + free_offset;
+    memset(entry, 0, DIR_ENTRY_SIZE);
+    memcpy(entry + DIR_NAME, short_name, 11);
+    entry[DIR_ATTR] = ATTR_ARCHIVE;
+    put16(entry + DIR_DATE, DATE_1980_01_01);
+    bcache_mark_dirty(free_block);
+    
+    load_entry(file, entry, free_block, free_offset);
+    return 0;
+}
+
+// Copy up to 'length' bytes from 'offset'. Returns the number of bytes
+// read (0 at the end of the file) or -1 on error.
+int fat_read(const fat_file_t* file, uint32_t offset, void* buffer, uint32_t length) {
+    if (!volume.mounted) return -1;
+    if (offset >= file->size) return 0;
+    if (length > file->size - offset) length = file->size - offset;
+    
+    uint32_t cluster_bytes = fat_cluster_bytes();
+    uint32_t cluster = file->first_cluster;
+    for (uint32_t i = 0; i < offset / cluster_bytes; i++) {
+        cluster = fat_get(cluster);
+    }
+    
+    uint8_t* out = buffer;
+    uint32_t done = 0;
+    while (done < length) {
+        if (!valid_cluster(cluster)) return -1;
+        
+        uint32_t in_cluster = offset % cluster_bytes;
+        uint8_t* sector = bcache_get(cluster_block(cluster) + in_cluster / BLOCK_SIZE);
+        if (sector == 0) return -1;
+        
+        uint32_t in_block = in_cluster % BLOCK_SIZE;
+        uint32_t count = BLOCK_SIZE - in_block;
+        if (count > length - done) count = length - done;
+        memcpy(out + done, sector + in_block, count);
+        
+        done += count;
+        offset += count;
+        if (offset % cluster_bytes == 0) {
+            cluster = fat_get(cluster);
+        }
+    }
+    return done;
+}
+
+// Append to the end of the file, growing its chain as needed. Blocks come
+// from the cache and may have to be read from the card (the directory
+// entry, FAT blocks while allocating), so call it from idle time; the data
+// reaches the card on a later bcache_idle().
+int fat_append(fat_file_t* file, const void* data, uint32_t length) {
+    if (!volume.mounted) return -1;
+    
+    const uint8_t* in = data;
+    uint32_t cluster_bytes = fat_cluster_bytes();
+    
+    while (length > 0) {
+        uint32_t in_cluster = file->size % cluster_bytes;
+        if (file->first_cluster == 0) {
+            file->first_cluster = allocate_cluster(0);
+            file->last_cluster = file->first_cluster;
+            if (file->first_cluster == 0) return -1;
+        } else if (in_cluster == 0 && file->size > 0) {
+            // Reuse a cluster already linked past the end, else allocate
+            uint32_t next = fat_get(file->last_cluster);
+            if (!valid_cluster(next)) {
+                next = allocate_cluster(file->last_cluster);
+                if (next == 0) return -1;
+            }
+            file->last_cluster = next;
+        }
+        
+        uint32_t block = cluster_block(file->last_cluster) + in_cluster / BLOCK_SIZE;
+        uint32_t in_block = in_cluster % BLOCK_SIZE;
+        uint8_t* sector = in_block ? bcache_get(block) : bcache_get_zeroed(block);
+        if (sector == 0) return -1;
+        
+        uint32_t count = BLOCK_SIZE - in_block;
+        if (count > length) count = length;
+        memcpy(sector + in_block, in, count);
+        bcache_mark_dirty(block);
+        
+        in += count;
+        length -= count;
+        file->size += count;
+    }
+    
+    // New size (and first cluster) in the directory entry
+    uint8_t* sector = bcache_get(file->dir_block);
+    if (sector == 0) return -1;
+    uint8_t* entry = sector + file->dir_offset;
+    put16(entry + DIR_CLUSTER_HIGH, file->first_cluster >> 16);
+    put16(entry + DIR_CLUSTER_LOW, file->first_cluster & 0xFFFF);
+    put32(entry + DIR_SIZE, file->size);
+    bcache_mark_dirty(file->dir_block);
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef FAT_H
+#define FAT_H
+
+#include "kernel.h"
+
+// Minimal FAT32 on the SD card, through the block cache: files in the root
+// directory with 8.3 names can be read and appended to (and created).
+// Either a partitioned card (first MBR partition) or a bare FAT32 volume.
+
+typedef struct {
+    uint32_t first_cluster;     // 0 while the file is empty
+    uint32_t last_cluster;      // Holds the file's last byte
+    uint32_t size;
+    uint32_t dir_block;         // Directory entry location
+    uint32_t dir_offset;
+} fat_file_t;
+
+// Function declarations
+int fat_mount(void);
+int fat_is_mounted(void);
+uint32_t fat_cluster_bytes(void);
+int fat_open(fat_file_t* file, const char* name, int create);
+int fat_read(const fat_file_t* file, uint32_t offset, void* buffer, uint32_t length);
+int fat_append(fat_file_t* file, const void* data, uint32_t length);
+
+#endif
@@ -0,0 +1,41 @@
+#include "fiq.h"
+#include "gpio.h"
+#include "interrupts.h"
+
+static fiq_queue_t fiq_queue __attribute__((aligned(16)));
+static fiq_source_t fiq_source = FIQ_SOURCE_NONE;
+
+// Route one source to FIQ (or back to nothing). Only one source can own
+// the FIQ at a time; it is taken off the normal IRQ path while routed.
+void fiq_route(fiq_source_t source) {
+    interrupts_disable_fiq();
+    gpio_set_button_events(0);
+    
+    fiq_queue.head = 0;
+    fiq_queue.tail = 0;
+    fiq_source = source;
+    
+    if (source == FIQ_SOURCE_GPIO_BUTTONS) {
+        fiq_setup_banked(GPIO_BASE, &fiq_queue, fiq_gpio_handler);
+        gpio_set_button_events(1);
+        interrupts_route_fiq(IRQ_GPIO_0);
+    }
+}
+
+fiq_source_t fiq_get_source(void) {
+    return fiq_source;
+}
+
+// Pop one event; returns 0 when the queue is empty
+int fiq_pop(uint32_t* value) {
+    uint32_t tail = fiq_queue.tail;
+    if (tail == fiq_queue.head) return 0;
+    
+    *value = fiq_queue.entries[tail];
+    fiq_queue.tail = (tail + 1) & (FIQ_QUEUE_SIZE - 1);
+    return 1;
+}
+
+uint32_t fiq_get_dropped(void) {
+    return fiq_queue.dropped;
+}
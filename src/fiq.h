@@ -0,0 +1,38 @@
+#ifndef FIQ_H
+#define FIQ_H
+
+#include "kernel.h"
+
+// FIQ fast path for the GPIO button bank. The FIQ handler in vectors.s
+// runs on the banked r8-r12 with no context save and only pushes the edge
+// event bits into a single-producer/single-consumer queue; the main loop
+// pops them with fiq_pop().
+
+// Queue size must match FIQ_QUEUE_MASK in vectors.s
+#define FIQ_QUEUE_SIZE  64
+
+// Layout is shared with the assembly handler
+typedef struct {
+    volatile uint32_t head;         // Written only by the FIQ handler
+    volatile uint32_t tail;         // Written only by the consumer
+    volatile uint32_t dropped;      // Events lost to a full queue
+    uint32_t reserved;
+    volatile uint32_t entries[FIQ_QUEUE_SIZE];
+} fiq_queue_t;
+
+typedef enum {
+    FIQ_SOURCE_NONE = 0,
+    FIQ_SOURCE_GPIO_BUTTONS = 1
+} fiq_source_t;
+
+// Function declarations
+void fiq_route(fiq_source_t source);
+fiq_source_t fiq_get_source(void);
+int fiq_pop(uint32_t* value);
+uint32_t fiq_get_dropped(void);
+
+// Assembly functions
+extern void fiq_setup_banked(uint32_t base, fiq_queue_t* queue, void (*handler)(void));
+extern void fiq_gpio_handler(void);
+
+#endif
@@ -1,160 +1,76 @@
 #include "framebuffer.h"
 #include "kernel.h"
-
-// Mailbox channels
-#define MAILBOX_CHANNEL_PROP    8
-
-// Mailbox registers
-#define MAILBOX_READ    (MAILBOX_BASE + 0x00)
-#define MAILBOX_STATUS  (MAILBOX_BASE + 0x18)
-#define MAILBOX_WRITE   (MAILBOX_BASE + 0x20)
-
-// Mailbox status bits
-#define MAILBOX_EMPTY   0x40000000
-#define MAILBOX_FULL    0x80000000
-
-// Property tags
-#define TAG_SET_PHYSICAL_SIZE   0x48003
-#define TAG_SET_VIRTUAL_SIZE    0x48004
-#define TAG_SET_DEPTH           0x48005
-#define TAG_ALLOCATE_BUFFER     0x40001
-#define TAG_GET_PITCH           0x40008
+#include "mailbox.h"
+#include "memory.h"
+#include "mmu.h"
+#include "memops.h"
 
 static framebuffer_t fb;
 
-// Mailbox property structure (must be 16-byte aligned)
-typedef struct {
-    uint32_t size;
-    uint32_t code;
-    
-    // Set physical size
-    uint32_t tag_physical;
-    uint32_t tag_physical_size;
-    uint32_t tag_physical_code;
-    uint32_t physical_width;
-    uint32_t physical_height;
-    
-    // Set virtual size  
-    uint32_t tag_virtual;
-    uint32_t tag_virtual_size;
-    uint32_t tag_virtual_code;
-    uint32_t virtual_width;
-    uint32_t virtual_height;
-    
-    // Set depth
-    uint32_t tag_depth;
-    uint32_t tag_depth_size;
-    uint32_t tag_depth_code;
-    uint32_t depth;
-    
-    // Allocate buffer
-    uint32_t tag_allocate;
-    uint32_t tag_allocate_size;
-    uint32_t tag_allocate_code;
-    uint32_t buffer_addr;
-    uint32_t buffer_size;
-    
-    // Get pitch
-    uint32_t tag_pitch;
-    uint32_t tag_pitch_size;
-    uint32_t tag_pitch_code;
-    uint32_t pitch;
-    
-    uint32_t end_tag;
-} __attribute__((aligned(16))) mailbox_property_t;
+// GPU-visible buffer and the cacheable shadow that drawing targets
+static uint32_t* hw_buffer = 0;
+static uint32_t* shadow_buffer = 0;
+static int shadow_enabled = 0;
 
-static mailbox_property_t property_buffer = {
-    .size = sizeof(mailbox_property_t),
-    .code = 0,
-    
-    .tag_physical = TAG_SET_PHYSICAL_SIZE,
-    .tag_physical_size = 8,
-    .tag_physical_code = 0,
-    .physical_width = SCREEN_WIDTH,
-    .physical_height = SCREEN_HEIGHT,
-    
-    .tag_virtual = TAG_SET_VIRTUAL_SIZE,
-    .tag_virtual_size = 8,
-    .tag_virtual_code = 0,
-    .virtual_width = SCREEN_WIDTH,
-    .virtual_height = SCREEN_HEIGHT,
-    
-    .tag_depth = TAG_SET_DEPTH,
-    .tag_depth_size = 4,
-    .tag_depth_code = 0,
-    .depth = SCREEN_DEPTH,
-    
-    .tag_allocate = TAG_ALLOCATE_BUFFER,
-    .tag_allocate_size = 8,
-    .tag_allocate_code = 0,
-    .buffer_addr = 0,
-    .buffer_size = 0,
-    
-    .tag_pitch = TAG_GET_PITCH,
-    .tag_pitch_size = 4,
-    .tag_pitch_code = 0,
-    .pitch = 0,
-    
-    .end_tag = 0
-};
+// Dirty tiles: bit x of dirty_rows[y] covers pixels [32x, 32x+31] x [32y, 32y+31]
+static uint32_t dirty_rows[FB_TILE_ROWS];
+static uint32_t tile_rows = 0;
+static uint32_t all_columns = 0;
 
-static void mailbox_write(uint8_t channel, uint32_t data) {
-    // Wait for mailbox to not be full
-    while (mmio_read(MAILBOX_STATUS) & MAILBOX_FULL) {
-        // Wait
-    }
-    
-    // Write data with channel
-    mmio_write(MAILBOX_WRITE, (data & 0xFFFFFFF0) | (channel & 0xF));
+static uint32_t hw_stride(void) {
+    return fb.pitch ? fb.pitch : fb.width * sizeof(uint32_t);
 }
 
-static uint32_t mailbox_read(uint8_t channel) {
-    uint32_t data;
-    
-    while (1) {
-        // Wait for mailbox to not be empty
-        while (mmio_read(MAILBOX_STATUS) & MAILBOX_EMPTY) {
-            // Wait
-        }
-        
-        // Read data
-        data = mmio_read(MAILBOX_READ);
-        
-        // Check if it's for our channel
-        if ((data & 0xF) == channel) {
-            return data & 0xFFFFFFF0;
-        }
-    }
-}
+// NEON copy of one 32-pixel wide tile column (src/blit.s)
+extern void blit_tile_32(uint32_t* dst, const uint32_t* src, uint32_t rows,
+                         uint32_t dst_stride, uint32_t src_stride);
 
+// Framebuffer setup: one batched property request
 int framebuffer_init(void) {
-    // Get physical address of property buffer
-    uint32_t addr = (uint32_t)&property_buffer;
-    
-    // Convert to bus address (add 0xC0000000 for uncached access)
-    addr += 0x40000000;
-    
-    // Send property buffer to GPU
-    mailbox_write(MAILBOX_CHANNEL_PROP, addr);
-    
-    // Read response
-    uint32_t result = mailbox_read(MAILBOX_CHANNEL_PROP);
-    
-    if (result != addr || property_buffer.code != 0x80000000) {
+    static mailbox_batch_t batch;
+    
+    mailbox_batch_begin(&batch);
+    uint32_t* physical = mailbox_batch_add(&batch, MAILBOX_TAG_SET_PHYSICAL_SIZE, 8);
+    uint32_t* virtual_size = mailbox_batch_add(&batch, MAILBOX_TAG_SET_VIRTUAL_SIZE, 8);
+    uint32_t* depth = mailbox_batch_add(&batch, MAILBOX_TAG_SET_DEPTH, 4);
+    uint32_t* allocate = mailbox_batch_add(&batch, MAILBOX_TAG_ALLOCATE_BUFFER, 8);
+    uint32_t* pitch = mailbox_batch_add(&batch, MAILBOX_TAG_GET_PITCH, 4);
+    
+    physical[0] = SCREEN_WIDTH;
+    physical[1] = SCREEN_HEIGHT;
+    virtual_size[0] = SCREEN_WIDTH;
+    virtual_size[1] = SCREEN_HEIGHT;
+    depth[0] = SCREEN_DEPTH;
+    allocate[0] = 16; // Alignment request; the response is base and size
+    
+    if (mailbox_call(&batch) != 0) {
         return -1; // Failed
     }
     
     // Check if buffer allocation succeeded
-    if (property_buffer.buffer_addr == 0) {
+    if (!mailbox_tag_ok(allocate) || allocate[0] == 0) {
         return -1;
     }
     
     // Set up framebuffer structure
-    fb.width = property_buffer.physical_width;
-    fb.height = property_buffer.physical_height;
-    fb.pitch = property_buffer.pitch;
-    fb.buffer = (uint32_t*)(property_buffer.buffer_addr & 0x3FFFFFFF); // Convert from bus to ARM address
-    fb.size = property_buffer.buffer_size;
+    fb.width = physical[0];
+    fb.height = physical[1];
+    fb.pitch = pitch[0];
+    hw_buffer = (uint32_t*)(allocate[0] & 0x3FFFFFFF); // Convert from bus to ARM address
+    fb.buffer = hw_buffer;
+    fb.size = allocate[1];
+    
+    tile_rows = (fb.height + FB_TILE_SIZE - 1) >> FB_TILE_SHIFT;
+    if (tile_rows > FB_TILE_ROWS) {
+        tile_rows = FB_TILE_ROWS;
+    }
+    uint32_t tile_columns = (fb.width + FB_TILE_SIZE - 1) >> FB_TILE_SHIFT;
+    all_columns = tile_columns >= 32 ? 0xFFFFFFFF : (1u << tile_columns) - 1;
+    
+    // Draw into cacheable RAM when there is room for a shadow copy
+    shadow_buffer = arena_alloc(memory_boot_arena(), fb.width * fb.height * sizeof(uint32_t),
+                                CACHE_LINE_SIZE);
+    framebuffer_set_shadow(shadow_buffer != 0);
     
     return 0; // Success
 }
@@ -167,6 +83,7 @@ void framebuffer_put_pixel(int x, int y, uint32_t color) {
     if (x >= 0 && x < fb.width && y >= 0 && y < fb.height) {
         uint32_t* pixel = fb.buffer + (y * fb.width + x);
         *pixel = color;
+        dirty_rows[y >> FB_TILE_SHIFT] |= 1u << (x >> FB_TILE_SHIFT);
     }
 }
 
@@ -179,7 +96,110 @@ uint32_t framebuffer_get_pixel(int x, int y) {
 }
 
 void framebuffer_clear(uint32_t color) {
-    for (int i = 0; i < fb.width * fb.height; i++) {
-        fb.buffer[i] = color;
+    memset32(fb.buffer, color, fb.width * fb.height);
+    framebuffer_mark_dirty(0, 0, fb.width, fb.height);
+}
+
+// Record a rectangle written directly through fb->buffer (clipped)
+void framebuffer_mark_dirty(int x, int y, int width, int height) {
+    int x1 = x + width - 1;
+    int y1 = y + height - 1;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x1 >= (int)fb.width) x1 = fb.width - 1;
+    if (y1 >= (int)fb.height) y1 = fb.height - 1;
+    if (x > x1 || y > y1) return;
+    
+    uint32_t first = x >> FB_TILE_SHIFT;
+    uint32_t last = x1 >> FB_TILE_SHIFT;
+    uint32_t columns = (last == 31 ? 0xFFFFFFFF : (1u << (last + 1)) - 1) & ~((1u << first) - 1);
+    
+    for (int row = y >> FB_TILE_SHIFT; row <= (y1 >> FB_TILE_SHIFT); row++) {
+        dirty_rows[row] |= columns;
+    }
+}
+
+// Copy the dirty tiles of the shadow to the GPU buffer; the "present" step.
+// Returns the number of tiles copied.
+uint32_t framebuffer_flush(void) {
+    uint32_t src_stride = fb.width * sizeof(uint32_t);
+    uint32_t dst_stride = hw_stride();
+    uint32_t flushed = 0;
+    
+    for (uint32_t row = 0; row < tile_rows; row++) {
+        uint32_t bits = dirty_rows[row] & all_columns;
+        dirty_rows[row] = 0;
+        if (!shadow_enabled) continue;
+        
+        uint32_t y = row << FB_TILE_SHIFT;
+        uint32_t rows = fb.height - y < FB_TILE_SIZE ? fb.height - y : FB_TILE_SIZE;
+        
+        while (bits) {
+            uint32_t column = 31 - __builtin_clz(bits);
+            bits &= ~(1u << column);
+            
+            uint32_t x = column << FB_TILE_SHIFT;
+            const uint32_t* src = shadow_buffer + y * fb.width + x;
+            uint32_t* dst = (uint32_t*)((uint8_t*)hw_buffer + y * dst_stride) + x;
+            
+            if (x + FB_TILE_SIZE <= fb.width) {
+                blit_tile_32(dst, src, rows, dst_stride, src_stride);
+            } else {
+                // Partial tile at the right edge
+                uint32_t bytes = (fb.width - x) * sizeof(uint32_t);
+                for (uint32_t r = 0; r < rows; r++) {
+                    memcpy(dst, src, bytes);
+                    src += fb.width;
+                    dst = (uint32_t*)((uint8_t*)dst + dst_stride);
+                }
+            }
+            flushed++;
+        }
     }
+    
+    dsb(); // Drain the write buffer so the GPU scans out complete tiles
+    return flushed;
+}
+
+// Switch drawing between the shadow and the GPU buffer. Enabling copies
+// the visible image into the shadow; disabling flushes it out first.
+void framebuffer_set_shadow(int enabled) {
+    if (enabled && shadow_buffer == 0) return;
+    if (enabled == shadow_enabled) return;
+    
+    if (enabled) {
+        for (uint32_t y = 0; y < fb.height; y++) {
+            const uint8_t* src = (const uint8_t*)hw_buffer + y * hw_stride();
+            memcpy_neon(shadow_buffer + y * fb.width, src, fb.width * sizeof(uint32_t));
+        }
+        fb.buffer = shadow_buffer;
+        shadow_enabled = 1;
+    } else {
+        framebuffer_flush();
+        fb.buffer = hw_buffer;
+        shadow_enabled = 0;
+    }
+}
+
+int framebuffer_shadow_enabled(void) {
+    return shadow_enabled;
+}
+
+uint32_t* framebuffer_get_hw_buffer(void) {
+    return hw_buffer;
+}
+
+// Block until the start of the next vertical blank. Returns -1 if the
+// firmware did not handle the request (e.g. under QEMU).
+int framebuffer_wait_vsync(void) {
+    static mailbox_batch_t batch;
+    
+    mailbox_batch_begin(&batch);
+    uint32_t* value = mailbox_batch_add(&batch, MAILBOX_TAG_WAIT_FOR_VSYNC, 4);
+    value[0] = 0;
+    
+    if (mailbox_call(&batch) != 0 || !mailbox_tag_ok(value)) {
+        return -1;
+    }
+    return 0;
 }
\ No newline at end of file
@@ -20,12 +20,21 @@
 #define COLOR_GRAY      0xFF808080
 #define COLOR_DARK_GRAY 0xFF404040
 
+// Shadow framebuffer: drawing goes to a copy in cacheable RAM and
+// framebuffer_flush() copies the 32x32 tiles that changed to the GPU's
+// buffer. Code that writes fb->buffer directly must report what it touched
+// with framebuffer_mark_dirty().
+#define FB_TILE_SHIFT   5
+#define FB_TILE_SIZE    (1 << FB_TILE_SHIFT)
+#define FB_TILE_ROWS    ((SCREEN_HEIGHT + FB_TILE_SIZE - 1) / FB_TILE_SIZE)
+// One bit per tile column in a 32-bit row mask: up to 1024 pixels wide
+
 // Framebuffer structure
 typedef struct {
     uint32_t width;
     uint32_t height;
     uint32_t pitch;
-    uint32_t* buffer;
+    uint32_t* buffer;       // Draw target: the shadow when enabled, else the GPU buffer
     uint32_t size;
 } framebuffer_t;
 
@@ -35,12 +44,27 @@ framebuffer_t* framebuffer_get(void);
 void framebuffer_put_pixel(int x, int y, uint32_t color);
 uint32_t framebuffer_get_pixel(int x, int y);
 void framebuffer_clear(uint32_t color);
+void framebuffer_mark_dirty(int x, int y, int width, int height);
+uint32_t framebuffer_flush(void);
+void framebuffer_set_shadow(int enabled);
+int framebuffer_shadow_enabled(void);
+uint32_t* framebuffer_get_hw_buffer(void);
+int framebuffer_wait_vsync(void);
 
 // Inline color utilities
 static inline uint32_t make_color(uint8_t r, uint8_t g, uint8_t b) {
     return 0xFF000000 | (r << 16) | (g << 8) | b;
 }
 
+// With alpha, for the blend module: 0 transparent, 255 opaque
+static inline uint32_t make_color_argb(uint8_t a, uint8_t r, uint8_t g, uint8_t b) {
+    return ((uint32_t)a << 24) | (r << 16) | (g << 8) | b;
+}
+
+static inline uint8_t get_alpha(uint32_t color) {
+    return color >> 24;
+}
+
 static inline uint8_t get_red(uint32_t color) {
     return (color >> 16) & 0xFF;
 }
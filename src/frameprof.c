@@ -0,0 +1,320 @@
+#include "frameprof.h"
+#include "graphics.h"
+#include "timer.h"
+#include "uart.h"
+#include "console.h"
+#include "blend.h"
+#include "memops.h"
+
+// HUD placement: top-right corner, clear of the score text and the grid
+#define HUD_WIDTH       264
+#define HUD_HEIGHT      60
+#define HUD_X           (SCREEN_WIDTH - HUD_WIDTH - 4)
+#define HUD_Y           4
+#define HUD_GRAPH_X     (HUD_X + 4)
+#define HUD_GRAPH_Y     (HUD_Y + 4)
+#define HUD_GRAPH_W     256     // One column per frame, newest on the right
+#define HUD_GRAPH_H     28
+#define HUD_TEXT_Y      (HUD_GRAPH_Y + HUD_GRAPH_H + 4)
+#define HUD_LEGEND_Y    (HUD_TEXT_Y + 10)
+
+#define HUD_BACKGROUND  0xC0101010      // Blended: the game shows through
+
+// Derived values accepted wherever a phase is
+#define STAT_BUSY       FRAME_PHASE_COUNT           // All phases but idle
+#define STAT_PERIOD     (FRAME_PHASE_COUNT + 1)     // Start to start
+
+typedef struct {
+    uint32_t phase_us[FRAME_PHASE_COUNT];
+} frame_record_t;
+
+typedef struct {
+    uint32_t min;
+    uint32_t avg;
+    uint32_t p99;
+} frame_stat_t;
+
+static frame_record_t history[FRAMEPROF_HISTORY];
+static uint32_t history_head = 0;   // Next slot to write
+static uint32_t history_count = 0;
+
+static frame_record_t current;
+static uint32_t last_mark = 0;
+static int frame_open = 0;
+static uint32_t budget_us = 100000;
+
+static volatile int hud_enabled = 0;
+static int hud_visible = 0;
+
+// What the HUD covers, put back before the next frame's drawing
+static uint32_t hud_under[HUD_WIDTH * HUD_HEIGHT];
+static uint32_t* hud_under_buffer = 0;
+
+static const uint32_t phase_colors[FRAME_PHASE_COUNT] = {
+    COLOR_CYAN,         // input
+    COLOR_YELLOW,       // update
+    COLOR_GREEN,        // draw
+    COLOR_MAGENTA,      // present
+    COLOR_DARK_GRAY     // idle (not drawn in the graph)
+};
+
+static const char* const phase_names[FRAME_PHASE_COUNT] = {
+    "input", "update", "draw", "present", "idle"
+};
+
+void frameprof_mark(frame_phase_t phase) {
+    uint32_t now = timer_get_ticks();
+    current.phase_us[phase] += now - last_mark;
+    last_mark = now;
+}
+
+void frameprof_frame_start(void) {
+    if (frame_open) {
+        frameprof_mark(FRAME_PHASE_IDLE);
+        for (int i = 0; i < FRAME_PHASE_COUNT; i++) {
+            history[history_head].phase_us[i] = current.phase_us[i];
+        }
+        history_head = (history_head + 1) % FRAMEPROF_HISTORY;
+        if (history_count < FRAMEPROF_HISTORY) {
+            history_count++;
+        }
+    } else {
+        last_mark = timer_get_ticks();
+        frame_open = 1;
+    }
+    
+    for (int i = 0; i < FRAME_PHASE_COUNT; i++) {
+        current.phase_us[i] = 0;
+    }
+}
+
+// Frame period the graph is scaled to: a full-height bar is 100% busy
+void frameprof_set_budget(uint32_t us) {
+    budget_us = us ? us : 1;
+}
+
+// Frames back from the newest: 0 is the last completed frame
+static const frame_record_t* record_at(uint32_t age) {
+    return &history[(history_head + FRAMEPROF_HISTORY - 1 - age) % FRAMEPROF_HISTORY];
+}
+
+// Busy time of a frame is everything except idle; the period includes it
+static uint32_t record_value(const frame_record_t* record, int phase) {
+    if (phase < FRAME_PHASE_COUNT) {
+        return record->phase_us[phase];
+    }
+    
+    int end = phase == STAT_PERIOD ? FRAME_PHASE_COUNT : FRAME_PHASE_IDLE;
+    uint32_t total = 0;
+    for (int i = 0; i < end; i++) {
+        total += record->phase_us[i];
+    }
+    return total;
+}
+
+// min/avg/p99 over the ring for one phase or derived value. With
+// at most 256 samples the 99th percentile is within the top three values,
+// so keep those instead of sorting.
+static void compute_stat(int phase, frame_stat_t* stat) {
+    uint32_t top[3] = { 0, 0, 0 };
+    uint32_t sum = 0;
+    
+    stat->min = 0xFFFFFFFF;
+    for (uint32_t age = 0; age < history_count; age++) {
+        uint32_t value = record_value(record_at(age), phase);
+        sum += value;
+        if (value < stat->min) {
+            stat->min = value;
+        }
+        
+        if (value > top[0]) {
+            top[2] = top[1];
+            top[1] = top[0];
+            top[0] = value;
+        } else if (value > top[1]) {
+            top[2] = top[1];
+            top[1] = value;
+        } else if (value > top[2]) {
+            top[2] = value;
+        }
+    }
+    
+    if (history_count == 0) {
+        stat->min = stat->avg = stat->p99 = 0;
+        return;
+    }
+    stat->avg = sum / history_count;
+    stat->p99 = top[history_count / 100];
+}
+
+// Append a decimal number to 'out', returns the new end
+static char* append_number(char* out, uint32_t value) {
+    char digits[10];
+    int count = 0;
+    
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    
+    while (count) {
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+static char* append_text(char* out, const char* text) {
+    while (*text) {
+        *out++ = *text++;
+    }
+    return out;
+}
+
+static void draw_graph(void) {
+    uint32_t columns = history_count < HUD_GRAPH_W ? history_count : HUD_GRAPH_W;
+    
+    for (uint32_t age = 0; age < columns; age++) {
+        const frame_record_t* record = record_at(age);
+        int x = HUD_GRAPH_X + HUD_GRAPH_W - 1 - age;
+        int bottom = HUD_GRAPH_Y + HUD_GRAPH_H;
+        
+        for (int phase = 0; phase < FRAME_PHASE_IDLE; phase++) {
+            uint32_t height = record->phase_us[phase] * HUD_GRAPH_H / budget_us;
+            if (height > (uint32_t)(bottom - HUD_GRAPH_Y)) {
+                height = bottom - HUD_GRAPH_Y;
+            }
+            if (height == 0) continue;
+            
+            bottom -= height;
+            graphics_draw_rect(x, bottom, 1, height, phase_colors[phase]);
+        }
+        
+        // Over budget: flag the top of the column
+        if (record_value(record, STAT_BUSY) > budget_us) {
+            graphics_draw_pixel(x, HUD_GRAPH_Y, COLOR_RED);
+        }
+    }
+}
+
+static void draw_text(void) {
+    char line[64];
+    char* end;
+    frame_stat_t busy;
+    
+    compute_stat(STAT_BUSY, &busy);
+    end = append_text(line, "busy min/avg/p99 ");
+    end = append_number(end, busy.min);
+    end = append_text(end, "/");
+    end = append_number(end, busy.avg);
+    end = append_text(end, "/");
+    end = append_number(end, busy.p99);
+    end = append_text(end, " us");
+    *end = '\0';
+    graphics_draw_text(line, HUD_GRAPH_X, HUD_TEXT_Y, COLOR_WHITE);
+    
+    // Legend: average per phase in the phase's graph color
+    int x = HUD_GRAPH_X;
+    for (int phase = 0; phase < FRAME_PHASE_IDLE; phase++) {
+        frame_stat_t stat;
+        compute_stat(phase, &stat);
+        
+        end = line;
+        *end++ = phase_names[phase][0] - 'a' + 'A';
+        end = append_number(end, stat.avg);
+        *end = '\0';
+        graphics_draw_text(line, x, HUD_LEGEND_Y, phase_colors[phase]);
+        x += (end - line + 1) * 8;
+    }
+}
+
+static uint32_t* hud_row(framebuffer_t* fb, int row) {
+    return fb->buffer + (HUD_Y + row) * fb->width + HUD_X;
+}
+
+// Put back the pixels under last frame's HUD. Called before the game and
+// the particles draw (after them in the frame, so erased before them), so
+// the translucent background always blends over a fresh picture.
+void frameprof_erase_hud(void) {
+    framebuffer_t* fb = framebuffer_get();
+    
+    // Nothing to restore into if the shadow was switched since
+    if (hud_visible && hud_under_buffer == fb->buffer) {
+        for (int row = 0; row < HUD_HEIGHT; row++) {
+            memcpy_neon(hud_row(fb, row), hud_under + row * HUD_WIDTH, HUD_WIDTH * sizeof(uint32_t));
+        }
+        framebuffer_mark_dirty(HUD_X, HUD_Y, HUD_WIDTH, HUD_HEIGHT);
+    }
+    hud_visible = 0;
+}
+
+// Paint the HUD over the finished frame; called in the present phase.
+// The pixels under it are saved first for frameprof_erase_hud().
+void frameprof_draw_hud(void) {
+    framebuffer_t* fb = framebuffer_get();
+    if (!hud_enabled || fb->width < (uint32_t)(HUD_X + HUD_WIDTH) ||
+        fb->height < (uint32_t)(HUD_Y + HUD_HEIGHT)) {
+        return;
+    }
+    
+    for (int row = 0; row < HUD_HEIGHT; row++) {
+        memcpy_neon(hud_under + row * HUD_WIDTH, hud_row(fb, row), HUD_WIDTH * sizeof(uint32_t));
+    }
+    hud_under_buffer = fb->buffer;
+    
+    blend_rect(HUD_X, HUD_Y, HUD_WIDTH, HUD_HEIGHT, HUD_BACKGROUND);
+    graphics_draw_rect_outline(HUD_X, HUD_Y, HUD_WIDTH, HUD_HEIGHT, COLOR_DARK_GRAY);
+    draw_graph();
+    draw_text();
+    hud_visible = 1;
+}
+
+static void print_stat(const char* name, int phase) {
+    frame_stat_t stat;
+    compute_stat(phase, &stat);
+    
+    uart_puts("  ");
+    uart_puts(name);
+    uart_puts(": min=");
+    uart_dec(stat.min);
+    uart_puts(" avg=");
+    uart_dec(stat.avg);
+    uart_puts(" p99=");
+    uart_dec(stat.p99);
+    uart_puts(" us\n");
+}
+
+void frameprof_print(void) {
+    uart_puts("Last ");
+    uart_dec(history_count);
+    uart_puts(" frames, budget ");
+    uart_dec(budget_us);
+    uart_puts(" us\n");
+    
+    for (int phase = 0; phase < FRAME_PHASE_COUNT; phase++) {
+        print_stat(phase_names[phase], phase);
+    }
+    print_stat("busy", STAT_BUSY);
+    print_stat("period", STAT_PERIOD);
+    
+    // Frames that could not be finished within their slot
+    uint32_t late = 0;
+    for (uint32_t age = 0; age < history_count; age++) {
+        if (record_value(record_at(age), STAT_BUSY) > budget_us) {
+            late++;
+        }
+    }
+    uart_puts("  over budget: ");
+    uart_dec(late);
+    uart_puts(" frames\n");
+}
+
+static void cmd_frames(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    frameprof_print();
+}
+
+void frameprof_register_console(void) {
+    console_register_var("hud", &hud_enabled, 0, 1, 0);
+    console_register_command("frames", cmd_frames, "per-phase frame time and period min/avg/p99");
+}
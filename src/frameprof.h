@@ -0,0 +1,29 @@
+#ifndef FRAMEPROF_H
+#define FRAMEPROF_H
+
+#include "kernel.h"
+
+// Per-frame phase timing for the main loop. Each call to frameprof_mark()
+// closes the named phase; frameprof_frame_start() closes the idle phase of
+// the previous frame and commits it to a ring of the last 256 frames.
+typedef enum {
+    FRAME_PHASE_INPUT = 0,
+    FRAME_PHASE_UPDATE,
+    FRAME_PHASE_DRAW,
+    FRAME_PHASE_PRESENT,
+    FRAME_PHASE_IDLE,
+    FRAME_PHASE_COUNT
+} frame_phase_t;
+
+#define FRAMEPROF_HISTORY   256
+
+// Function declarations
+void frameprof_frame_start(void);
+void frameprof_mark(frame_phase_t phase);
+void frameprof_set_budget(uint32_t budget_us);
+void frameprof_erase_hud(void);
+void frameprof_draw_hud(void);
+void frameprof_print(void);
+void frameprof_register_console(void);
+
+#endif
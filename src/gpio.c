@@ -67,10 +67,12 @@ void gpio_set_function(int pin, gpio_function_t func) {
     int shift = (pin % 10) * 3;
     uint32_t sel_reg = GPIO_BASE + (reg * 4);
     
-    uint32_t value = mmio_read(sel_reg);
+    peripheral_enter();
+    uint32_t value = mmio_read_relaxed(sel_reg);
     value &= ~(7 << shift);  // Clear the 3 bits
     value |= (func << shift); // Set new function
-    mmio_write(sel_reg, value);
+    mmio_write_relaxed(sel_reg, value);
+    peripheral_exit();
 }
 
 void gpio_set_output(int pin, int value) {
@@ -108,25 +110,45 @@ void gpio_set_pull(int pin, gpio_pull_t pull) {
     if (pin < 0 || pin > 53) return;
     
     // Set pull-up/down control
-    mmio_write(GPPUD, pull);
+    peripheral_enter();
+    mmio_write_relaxed(GPPUD, pull);
     
     // Wait 150 cycles
     delay(150);
     
     // Clock the control signal into the pin
     if (pin < 32) {
-        mmio_write(GPPUDCLK0, 1 << pin);
+        mmio_write_relaxed(GPPUDCLK0, 1 << pin);
     } else {
-        mmio_write(GPPUDCLK1, 1 << (pin - 32));
+        mmio_write_relaxed(GPPUDCLK1, 1 << (pin - 32));
     }
     
     // Wait 150 cycles
     delay(150);
     
     // Remove control signal and clock
-    mmio_write(GPPUD, 0);
-    mmio_write(GPPUDCLK0, 0);
-    mmio_write(GPPUDCLK1, 0);
+    mmio_write_relaxed(GPPUD, 0);
+    mmio_write_relaxed(GPPUDCLK0, 0);
+    mmio_write_relaxed(GPPUDCLK1, 0);
+    peripheral_exit();
+}
+
+// Latch button presses (falling edges) in GPEDS0 so they raise the bank 0
+// interrupt; used by the FIQ input path
+void gpio_set_button_events(int enabled) {
+    peripheral_enter();
+    uint32_t value = mmio_read_relaxed(GPFEN0);
+    
+    if (enabled) {
+        value |= GPIO_BUTTON_MASK;
+    } else {
+        value &= ~GPIO_BUTTON_MASK;
+    }
+    mmio_write_relaxed(GPFEN0, value);
+    
+    // Discard stale events
+    mmio_write_relaxed(GPEDS0, GPIO_BUTTON_MASK);
+    peripheral_exit();
 }
 
 // Simple button reading functions
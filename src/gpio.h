@@ -22,12 +22,21 @@ typedef enum {
     GPIO_PULL_UP = 2
 } gpio_pull_t;
 
+// Button pins (active low, pulled up)
+#define GPIO_BUTTON_UP      2
+#define GPIO_BUTTON_DOWN    3
+#define GPIO_BUTTON_LEFT    4
+#define GPIO_BUTTON_RIGHT   17
+#define GPIO_BUTTON_MASK    ((1 << GPIO_BUTTON_UP) | (1 << GPIO_BUTTON_DOWN) | \
+                             (1 << GPIO_BUTTON_LEFT) | (1 << GPIO_BUTTON_RIGHT))
+
 // Function declarations
 void gpio_init(void);
 void gpio_set_function(int pin, gpio_function_t func);
 void gpio_set_output(int pin, int value);
 int gpio_get_input(int pin);
 void gpio_set_pull(int pin, gpio_pull_t pull);
+void gpio_set_button_events(int enabled);
 
 // Button functions (using specific pins)
 int gpio_read_button_up(void);    // GPIO 2
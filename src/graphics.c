@@ -1,5 +1,7 @@
 #include "graphics.h"
 #include "framebuffer.h"
+#include "profile.h"
+#include "memops.h"
 
 // Simple 8x8 font (ASCII characters 32-126)
 static const uint8_t font_8x8[95][8] = {
@@ -65,6 +67,7 @@ static const uint8_t font_8x8[95][8] = {
 };
 
 void graphics_clear_screen(uint32_t color) {
+    PROFILE_SCOPE(clear_screen);
     framebuffer_clear(color);
 }
 
@@ -96,12 +99,23 @@ void graphics_draw_line(int x0, int y0, int x1, int y1, uint32_t color) {
     }
 }
 
+// Filled rectangle: clip once, then fill whole rows with memset32
 void graphics_draw_rect(int x, int y, int width, int height, uint32_t color) {
-    for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            graphics_draw_pixel(x + j, y + i, color);
-        }
+    framebuffer_t* fb = framebuffer_get();
+    int x1 = x + width;
+    int y1 = y + height;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x1 > (int)fb->width) x1 = fb->width;
+    if (y1 > (int)fb->height) y1 = fb->height;
+    if (x >= x1 || y >= y1) return;
+    
+    uint32_t* row = fb->buffer + y * fb->width + x;
+    for (int i = y; i < y1; i++) {
+        memset32(row, color, x1 - x);
+        row += fb->width;
     }
+    framebuffer_mark_dirty(x, y, x1 - x, y1 - y);
 }
 
 void graphics_draw_rect_outline(int x, int y, int width, int height, uint32_t color) {
@@ -146,6 +160,7 @@ void graphics_draw_circle(int cx, int cy, int radius, uint32_t color) {
 
 void graphics_draw_char(char c, int x, int y, uint32_t color) {
     if (c < 32 || c > 126) return;
+    PROFILE_SCOPE(draw_char);
     
     int font_index = c - 32;
     const uint8_t* glyph = font_8x8[font_index];
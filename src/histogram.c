@@ -0,0 +1,49 @@
+#include "histogram.h"
+#include "uart.h"
+
+void hist_reset(hist_log2_t* hist) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        hist->buckets[i] = 0;
+    }
+    hist->count = 0;
+    hist->max = 0;
+    hist->sum = 0;
+}
+
+// Print summary plus one line per non-empty bucket, e.g. "  [8-15] 42"
+void hist_print(const char* name, const char* unit, const hist_log2_t* hist) {
+    uart_puts("  ");
+    uart_puts(name);
+    uart_puts(": n=");
+    uart_dec(hist->count);
+    
+    if (hist->count == 0) {
+        uart_puts("\n");
+        return;
+    }
+    
+    uart_puts(" avg=");
+    uart_dec(hist->sum / hist->count);
+    uart_puts(unit);
+    uart_puts(" max=");
+    uart_dec(hist->max);
+    uart_puts(unit);
+    uart_puts("\n");
+    
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        if (hist->buckets[i] == 0) continue;
+        
+        uint32_t low = i ? 1u << (i - 1) : 0;
+        uart_puts("    [");
+        uart_dec(low);
+        if (i == HIST_BUCKETS - 1) {
+            uart_puts("+");
+        } else if (i > 1) {
+            uart_puts("-");
+            uart_dec((1u << i) - 1);
+        }
+        uart_puts("] ");
+        uart_dec(hist->buckets[i]);
+        uart_puts("\n");
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "kernel.h"
+
+// Log2 histogram: bucket 0 counts zeros, bucket n counts values in
+// [2^(n-1), 2^n - 1]. The last bucket also absorbs anything larger.
+#define HIST_BUCKETS    24
+
+typedef struct {
+    uint32_t buckets[HIST_BUCKETS];
+    uint32_t count;
+    uint32_t max;
+    uint32_t sum;   // 32-bit on purpose: no 64-bit division without libgcc
+} hist_log2_t;
+
+static inline void hist_record(hist_log2_t* hist, uint32_t value) {
+    int bucket = value ? 32 - __builtin_clz(value) : 0;
+    if (bucket >= HIST_BUCKETS) {
+        bucket = HIST_BUCKETS - 1;
+    }
+    
+    hist->buckets[bucket]++;
+    hist->count++;
+    hist->sum += value;
+    if (value > hist->max) {
+        hist->max = value;
+    }
+}
+
+// Function declarations
+void hist_reset(hist_log2_t* hist);
+void hist_print(const char* name, const char* unit, const hist_log2_t* hist);
+
+#endif
@@ -1,6 +1,7 @@
 #include "interrupts.h"
 #include "timer.h"
 #include "uart.h"
+#include "histogram.h"
 #include "kernel.h"
 
 // Interrupt controller registers
@@ -15,10 +16,6 @@
 #define DISABLE_IRQS_2      (INTERRUPT_BASE + 0x220)
 #define DISABLE_BASIC_IRQS  (INTERRUPT_BASE + 0x224)
 
-// IRQ numbers
-#define IRQ_TIMER_1         1
-#define IRQ_UART            57
-
 // Basic IRQ bits
 #define BASIC_IRQ_TIMER     (1 << 0)
 #define BASIC_IRQ_MAILBOX   (1 << 1)
@@ -29,8 +26,64 @@
 #define BASIC_IRQ_ACCESS_ERR_1 (1 << 6)
 #define BASIC_IRQ_ACCESS_ERR_0 (1 << 7)
 
+// FIQ control register
+#define FIQ_CONTROL_ENABLE  (1 << 7)
+#define FIQ_CONTROL_SOURCE  0x7F
+
+// Basic pending register layout
+#define BASIC_PENDING_ARM_MASK      0x000000FF  // ARM-local IRQs 64-71
+#define BASIC_PENDING_1             (1 << 8)    // Bits set in pending register 1
+#define BASIC_PENDING_2             (1 << 9)    // Bits set in pending register 2
+#define BASIC_PENDING_SHORTCUT_SHIFT 10
+#define BASIC_PENDING_SHORTCUT_MASK 0x7FF       // Bits 10-20
+
+// GPU IRQs mirrored as shortcut bits 10-20 of the basic pending register
+static const uint8_t shortcut_irqs[11] = { 7, 9, 10, 18, 19, 53, 54, 55, 56, 57, 62 };
+
+// Shortcut sources, masked out of pending 1/2 since they are already handled
+#define SHORTCUT_MASK_1 ((1u << 7) | (1u << 9) | (1u << 10) | (1u << 18) | (1u << 19))
+#define SHORTCUT_MASK_2 ((1u << (53 - 32)) | (1u << (54 - 32)) | (1u << (55 - 32)) | \
+                         (1u << (56 - 32)) | (1u << (57 - 32)) | (1u << (62 - 32)))
+
 extern void vectors_start(void);
 
+typedef struct {
+    irq_handler_t handler;
+    void* ctx;
+} irq_entry_t;
+
+static irq_entry_t irq_table[IRQ_COUNT];
+
+// Interrupts serviced per IRQ line since boot
+static volatile uint32_t irq_counts[IRQ_COUNT];
+static volatile uint32_t irq_spurious = 0;
+
+// Per-IRQ handler duration and entry latency (us, log2 buckets)
+typedef struct {
+    hist_log2_t duration;
+    hist_log2_t latency;
+} irq_stats_t;
+
+static irq_stats_t irq_stats[IRQ_COUNT];
+
+// System Timer value when the current IRQ was entered
+static volatile uint32_t irq_entry_time = 0;
+static volatile uint32_t irq_interrupted_pc = 0;
+
+static void uart_irq(void* ctx) {
+    (void)ctx;
+    
+    // UART transmit interrupt - refill the FIFO from the TX ring
+    uart_handle_tx_interrupt();
+    
+    // UART receive interrupt - read available characters
+    int c;
+    while ((c = uart_getc_nonblocking()) != -1) {
+        // Handle input for snake game
+        handle_uart_input((char)c);
+    }
+}
+
 void interrupts_init(void) {
     // Install vector table
     uint32_t vector_table = (uint32_t)&vectors_start;
@@ -44,52 +97,90 @@ void interrupts_init(void) {
     );
     
     // Clear all pending interrupts
-    mmio_write(IRQ_BASIC_PENDING, 0);
-    mmio_write(IRQ_PENDING_1, 0);
-    mmio_write(IRQ_PENDING_2, 0);
+    peripheral_enter();
+    mmio_write_relaxed(IRQ_BASIC_PENDING, 0);
+    mmio_write_relaxed(IRQ_PENDING_1, 0);
+    mmio_write_relaxed(IRQ_PENDING_2, 0);
     
     // Disable all interrupts initially
-    mmio_write(DISABLE_BASIC_IRQS, 0xFFFFFFFF);
-    mmio_write(DISABLE_IRQS_1, 0xFFFFFFFF);
-    mmio_write(DISABLE_IRQS_2, 0xFFFFFFFF);
+    mmio_write_relaxed(DISABLE_BASIC_IRQS, 0xFFFFFFFF);
+    mmio_write_relaxed(DISABLE_IRQS_1, 0xFFFFFFFF);
+    mmio_write_relaxed(DISABLE_IRQS_2, 0xFFFFFFFF);
+    peripheral_exit();
     
-    // Enable timer interrupt (IRQ 1)
-    mmio_write(ENABLE_IRQS_1, (1 << IRQ_TIMER_1));
+    // UART interrupt (IRQ 57)
+    irq_register(IRQ_UART, uart_irq, 0);
     
-    // Enable UART interrupt (IRQ 57)
-    mmio_write(ENABLE_IRQS_2, (1 << (IRQ_UART - 32)));
-    
-    // Set timer for periodic interrupts (every 10ms)
-    timer_set_interval(10);
+    // Timer interrupts: periodic tick (every 10ms) and sleep wakeups
+    timer_irq_init();
     
     // Enable interrupts in CPU
     enable_interrupts();
 }
 
-void handle_irq(void) {
-    uint32_t basic_pending = mmio_read(IRQ_BASIC_PENDING);
-    uint32_t pending_1 = mmio_read(IRQ_PENDING_1);
-    uint32_t pending_2 = mmio_read(IRQ_PENDING_2);
+static inline void dispatch(int irq) {
+    irq_entry_t* entry = &irq_table[irq];
+    
+    irq_counts[irq]++;
+    if (entry->handler) {
+        uint32_t start = timer_get_ticks();
+        entry->handler(entry->ctx);
+        hist_record(&irq_stats[irq].duration, timer_get_ticks() - start);
+    } else {
+        // Nobody owns this source - mask it rather than loop forever
+        irq_spurious++;
+        interrupts_disable_irq(irq);
+    }
+}
+
+// Dispatch cost scales with the number of active sources: the basic pending
+// register is always read, pending 1/2 only when it says they have
+// non-shortcut bits, and set bits are walked with clz.
+// The IRQ may have landed inside a driver's relaxed register sequence, so
+// the handler is bracketed like a peripheral switch in both directions.
+void handle_irq(uint32_t interrupted_pc) {
+    peripheral_enter();
+    irq_entry_time = timer_get_ticks();
+    irq_interrupted_pc = interrupted_pc;
     
-    // Handle timer interrupt
-    if (pending_1 & (1 << IRQ_TIMER_1)) {
-        timer_handle_interrupt();
+    uint32_t basic_pending = mmio_read_relaxed(IRQ_BASIC_PENDING);
+    uint32_t bits;
+    
+    // ARM-local sources (IRQs 64-71)
+    bits = basic_pending & BASIC_PENDING_ARM_MASK;
+    while (bits) {
+        int bit = 31 - __builtin_clz(bits);
+        bits &= ~(1u << bit);
+        dispatch(IRQ_BASIC_BASE + bit);
+    }
+    
+    // Shortcut bits for common GPU sources (including the UART)
+    bits = (basic_pending >> BASIC_PENDING_SHORTCUT_SHIFT) & BASIC_PENDING_SHORTCUT_MASK;
+    while (bits) {
+        int bit = 31 - __builtin_clz(bits);
+        bits &= ~(1u << bit);
+        dispatch(shortcut_irqs[bit]);
     }
     
-    // Handle UART interrupt  
-    if (pending_2 & (1 << (IRQ_UART - 32))) {
-        // UART receive interrupt - read available characters
-        int c;
-        while ((c = uart_getc_nonblocking()) != -1) {
-            // Handle input for snake game
-            handle_uart_input((char)c);
+    // Remaining GPU sources (e.g. the system timer) need the full registers
+    if (basic_pending & BASIC_PENDING_1) {
+        bits = mmio_read(IRQ_PENDING_1) & ~SHORTCUT_MASK_1;
+        while (bits) {
+            int bit = 31 - __builtin_clz(bits);
+            bits &= ~(1u << bit);
+            dispatch(bit);
         }
     }
     
-    // Handle basic IRQs
-    if (basic_pending) {
-        // Handle other basic interrupts if needed
+    if (basic_pending & BASIC_PENDING_2) {
+        bits = mmio_read(IRQ_PENDING_2) & ~SHORTCUT_MASK_2;
+        while (bits) {
+            int bit = 31 - __builtin_clz(bits);
+            bits &= ~(1u << bit);
+            dispatch(32 + bit);
+        }
     }
+    peripheral_exit();
 }
 
 // Weak symbol - can be overridden by snake.c
@@ -98,11 +189,37 @@ __attribute__((weak)) void handle_uart_input(char c) {
     uart_putc(c);
 }
 
+// Install a handler for an IRQ and enable the source
+void irq_register(int irq, irq_handler_t handler, void* ctx) {
+    if (irq < 0 || irq >= IRQ_COUNT) return;
+    
+    uint32_t flags = irq_save();
+    irq_table[irq].handler = handler;
+    irq_table[irq].ctx = ctx;
+    irq_restore(flags);
+    
+    interrupts_enable_irq(irq);
+}
+
+// Disable an IRQ and remove its handler
+void irq_unregister(int irq) {
+    if (irq < 0 || irq >= IRQ_COUNT) return;
+    
+    interrupts_disable_irq(irq);
+    
+    uint32_t flags = irq_save();
+    irq_table[irq].handler = 0;
+    irq_table[irq].ctx = 0;
+    irq_restore(flags);
+}
+
 void interrupts_enable_irq(int irq) {
     if (irq < 32) {
         mmio_write(ENABLE_IRQS_1, (1 << irq));
     } else if (irq < 64) {
         mmio_write(ENABLE_IRQS_2, (1 << (irq - 32)));
+    } else if (irq < IRQ_COUNT) {
+        mmio_write(ENABLE_BASIC_IRQS, (1 << (irq - IRQ_BASIC_BASE)));
     }
 }
 
@@ -111,5 +228,72 @@ void interrupts_disable_irq(int irq) {
         mmio_write(DISABLE_IRQS_1, (1 << irq));
     } else if (irq < 64) {
         mmio_write(DISABLE_IRQS_2, (1 << (irq - 32)));
+    } else if (irq < IRQ_COUNT) {
+        mmio_write(DISABLE_BASIC_IRQS, (1 << (irq - IRQ_BASIC_BASE)));
+    }
+}
+
+// Deliver one source as FIQ instead of IRQ. The source must not also be
+// enabled as an IRQ, so it is masked on the IRQ side first.
+void interrupts_route_fiq(int irq) {
+    if (irq < 0 || irq >= IRQ_COUNT) return;
+    
+    interrupts_disable_irq(irq);
+    mmio_write(FIQ_CONTROL, FIQ_CONTROL_ENABLE | (irq & FIQ_CONTROL_SOURCE));
+}
+
+void interrupts_disable_fiq(void) {
+    mmio_write(FIQ_CONTROL, 0);
+}
+
+uint32_t interrupts_get_count(int irq) {
+    if (irq < 0 || irq >= IRQ_COUNT) return 0;
+    return irq_counts[irq];
+}
+
+uint32_t interrupts_get_spurious(void) {
+    return irq_spurious;
+}
+
+// System Timer value latched at entry to the IRQ being handled
+uint32_t interrupts_entry_time(void) {
+    return irq_entry_time;
+}
+
+// Address of the instruction the current IRQ interrupted (for sampling)
+uint32_t interrupts_interrupted_pc(void) {
+    return irq_interrupted_pc;
+}
+
+// Record how late a source was serviced, for sources that know their
+// deadline (e.g. timer compares). Call from the source's handler.
+void interrupts_record_latency(int irq, uint32_t latency_us) {
+    if (irq < 0 || irq >= IRQ_COUNT) return;
+    hist_record(&irq_stats[irq].latency, latency_us);
+}
+
+void interrupts_print_stats(void) {
+    for (int irq = 0; irq < IRQ_COUNT; irq++) {
+        if (irq_counts[irq] == 0) continue;
+        
+        uart_puts("IRQ ");
+        uart_dec(irq);
+        uart_puts(": ");
+        uart_dec(irq_counts[irq]);
+        uart_puts(" interrupts\n");
+        
+        hist_print("duration", "us", &irq_stats[irq].duration);
+        if (irq_stats[irq].latency.count) {
+            hist_print("latency", "us", &irq_stats[irq].latency);
+        }
+    }
+}
+
+void interrupts_reset_stats(void) {
+    uint32_t flags = irq_save();
+    for (int irq = 0; irq < IRQ_COUNT; irq++) {
+        hist_reset(&irq_stats[irq].duration);
+        hist_reset(&irq_stats[irq].latency);
     }
+    irq_restore(flags);
 }
\ No newline at end of file
@@ -3,11 +3,33 @@
 
 #include "kernel.h"
 
+// IRQ numbers: 0-63 are GPU sources, 64-71 the ARM-local basic sources
+#define IRQ_TIMER_1         1
+#define IRQ_TIMER_3         3
+#define IRQ_GPIO_0          49
+#define IRQ_UART            57
+#define IRQ_BASIC_BASE      64
+#define IRQ_COUNT           72
+
+// IRQ handler, called with the context pointer given at registration
+typedef void (*irq_handler_t)(void* ctx);
+
 // Function declarations
 void interrupts_init(void);
-void handle_irq(void);
+void handle_irq(uint32_t interrupted_pc);
 void handle_uart_input(char c);
+void irq_register(int irq, irq_handler_t handler, void* ctx);
+void irq_unregister(int irq);
 void interrupts_enable_irq(int irq);
 void interrupts_disable_irq(int irq);
+void interrupts_route_fiq(int irq);
+void interrupts_disable_fiq(void);
+uint32_t interrupts_get_count(int irq);
+uint32_t interrupts_get_spurious(void);
+uint32_t interrupts_entry_time(void);
+uint32_t interrupts_interrupted_pc(void);
+void interrupts_record_latency(int irq, uint32_t latency_us);
+void interrupts_print_stats(void);
+void interrupts_reset_stats(void);
 
 #endif
\ No newline at end of file
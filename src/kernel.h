@@ -17,6 +17,10 @@ extern uint32_t __bss_start;
 extern uint32_t __bss_end;
 extern uint32_t __heap_start;
 extern uint32_t __stack_start;
+extern uint32_t __text_start;
+extern uint32_t __text_end;
+extern uint32_t __levels_start;
+extern uint32_t __levels_end;
 
 // Utility macros
 #ifndef TRUE
@@ -39,17 +43,52 @@ static inline void isb(void) {
     __asm__ volatile ("isb" ::: "memory");
 }
 
-// Register access
-static inline void mmio_write(uint32_t reg, uint32_t data) {
+// Peripheral ordering (BCM2835 ARM Peripherals, 1.3): accesses to one
+// peripheral arrive in order, but data from different peripherals can
+// overtake each other. A barrier is only needed when switching
+// peripherals, so drivers bracket each multi-register sequence with
+// peripheral_enter()/peripheral_exit() and use the relaxed accessors
+// inside. Interrupt and FIQ entry/exit do the same, so a handler that
+// fires mid-sequence cannot break the ordering.
+static inline void peripheral_enter(void) {
     memory_barrier();
-    *(volatile uint32_t*)reg = data;
+}
+
+static inline void peripheral_exit(void) {
     memory_barrier();
 }
 
+static inline void mmio_write_relaxed(uint32_t reg, uint32_t data) {
+    *(volatile uint32_t*)(uintptr_t)reg = data;
+}
+
+static inline uint32_t mmio_read_relaxed(uint32_t reg) {
+    return *(volatile uint32_t*)(uintptr_t)reg;
+}
+
+// Self-contained register access for one-off touches outside a sequence
+static inline void mmio_write(uint32_t reg, uint32_t data) {
+    peripheral_enter();
+    mmio_write_relaxed(reg, data);
+    peripheral_exit();
+}
+
 static inline uint32_t mmio_read(uint32_t reg) {
-    memory_barrier();
-    return *(volatile uint32_t*)reg;
-    memory_barrier();
+    peripheral_enter();
+    uint32_t data = mmio_read_relaxed(reg);
+    peripheral_exit();
+    return data;
+}
+
+// Interrupt masking for short critical sections (nests safely)
+static inline uint32_t irq_save(void) {
+    uint32_t cpsr;
+    __asm__ volatile ("mrs %0, cpsr\n\tcpsid i" : "=r"(cpsr) :: "memory");
+    return cpsr;
+}
+
+static inline void irq_restore(uint32_t cpsr) {
+    __asm__ volatile ("msr cpsr_c, %0" :: "r"(cpsr) : "memory");
 }
 
 // Delay function
@@ -0,0 +1,181 @@
+#include "level.h"
+#include "framebuffer.h"
+#include "memory.h"
+#include "memops.h"
+#include "timer.h"
+#include "snake.h"
+
+#define LEVEL_MAGIC         "SLV1"
+#define RUN_WALL            0x80
+#define RUN_LENGTH_MASK     0x7F
+
+#define BACKGROUND_WIDTH    (LEVEL_WIDTH * LEVEL_CELL_SIZE)
+#define BACKGROUND_HEIGHT   (LEVEL_HEIGHT * LEVEL_CELL_SIZE)
+
+// Collision grid of the loaded level, one byte per cell
+static uint8_t walls[LEVEL_HEIGHT * LEVEL_WIDTH];
+
+// Static background layer: the playfield with its walls, copied to the
+// screen on a full repaint (boot arena, allocated by the first load)
+static uint32_t* background = 0;
+
+static int current = -1;
+static uint32_t load_us = 0;
+
+static int header_valid(const level_header_t* level, const uint8_t* end) {
+    const char* magic = LEVEL_MAGIC;
+    for (int i = 0; i < 4; i++) {
+        if (level->magic[i] != magic[i]) return 0;
+    }
+    return level->size >= sizeof(level_header_t) &&
+           (const uint8_t*)level + level->size <= end &&
+           sizeof(level_header_t) + level->rle_length <= level->size;
+}
+
+// Walk the section entry by entry; stops at the first malformed header
+const level_header_t* level_get(int index) {
+    const uint8_t* entry = (const uint8_t*)&__levels_start;
+    const uint8_t* end = (const uint8_t*)&__levels_end;
+    
+    while (index >= 0 && entry + sizeof(level_header_t) <= end) {
+        const level_header_t* level = (const level_header_t*)entry;
+        if (!header_valid(level, end)) break;
+        if (index-- == 0) return level;
+        entry += level->size;
+    }
+    return 0;
+}
+
+int level_count(void) {
+    int count = 0;
+    while (level_get(count)) {
+        count++;
+    }
+    return count;
+}
+
+// Wall or floor of a cell, straight from the runs (-1 outside the grid)
+static int run_is_wall(const level_header_t* level, int x, int y) {
+    if (x < 0 || x >= LEVEL_WIDTH || y < 0 || y >= LEVEL_HEIGHT) return -1;
+    
+    const uint8_t* runs = (const uint8_t*)(level + 1);
+    uint32_t target = y * LEVEL_WIDTH + x;
+    uint32_t cell = 0;
+    for (uint32_t i = 0; i < level->rle_length; i++) {
+        cell += (runs[i] & RUN_LENGTH_MASK) + 1;
+        if (target < cell) return (runs[i] & RUN_WALL) ? 1 : 0;
+    }
+    return -1;
+}
+
+// The runs must cover the grid exactly, and the spawn and the two body
+// cells behind it must be floor (what tools/mklevel.py guarantees; this
+// catches entries edited or corrupted after the fact)
+static int level_valid(const level_header_t* level) {
+    if (level->width != LEVEL_WIDTH || level->height != LEVEL_HEIGHT) return 0;
+    if (level->direction > DIRECTION_RIGHT) return 0;
+    
+    const uint8_t* runs = (const uint8_t*)(level + 1);
+    uint32_t cells = 0;
+    for (uint32_t i = 0; i < level->rle_length; i++) {
+        cells += (runs[i] & RUN_LENGTH_MASK) + 1;
+    }
+    if (cells != LEVEL_WIDTH * LEVEL_HEIGHT) return 0;
+    
+    // Step from the head towards the body, as in snake_init()
+    int dx = 0, dy = 0;
+    switch (level->direction) {
+        case DIRECTION_UP:    dy = 1;  break;
+        case DIRECTION_DOWN:  dy = -1; break;
+        case DIRECTION_LEFT:  dx = 1;  break;
+        case DIRECTION_RIGHT: dx = -1; break;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (run_is_wall(level, level->spawn_x + dx * i, level->spawn_y + dy * i) != 0) return 0;
+    }
+    return 1;
+}
+
+// Paint one wall cell into the background, leaving the 1px grid gap
+static void draw_wall(uint32_t cell) {
+    uint32_t x = (cell % LEVEL_WIDTH) * LEVEL_CELL_SIZE;
+    uint32_t y = (cell / LEVEL_WIDTH) * LEVEL_CELL_SIZE;
+    uint32_t* row = background + y * BACKGROUND_WIDTH + x;
+    
+    for (int i = 0; i < LEVEL_CELL_SIZE - 1; i++) {
+        memset32(row, LEVEL_WALL_COLOR, LEVEL_CELL_SIZE - 1);
+        row += BACKGROUND_WIDTH;
+    }
+}
+
+// Decode a level straight into the collision grid and the background.
+// Returns 0 on success; on failure the previous level stays loaded.
+int level_load(int index) {
+    const level_header_t* level = level_get(index);
+    if (level == 0 || !level_valid(level)) return -1;
+    
+    if (background == 0) {
+        background = boot_alloc(BACKGROUND_WIDTH * BACKGROUND_HEIGHT * sizeof(uint32_t));
+        if (background == 0) return -1;
+    }
+    
+    uint32_t start = timer_get_ticks();
+    memset32(background, COLOR_BLACK, BACKGROUND_WIDTH * BACKGROUND_HEIGHT);
+    
+    const uint8_t* runs = (const uint8_t*)(level + 1);
+    uint32_t cell = 0;
+    for (uint32_t i = 0; i < level->rle_length; i++) {
+        uint32_t length = (runs[i] & RUN_LENGTH_MASK) + 1;
+        uint8_t wall = (runs[i] & RUN_WALL) ? 1 : 0;
+        
+        memset(&walls[cell], wall, length);
+        if (wall) {
+            for (uint32_t j = 0; j < length; j++) {
+                draw_wall(cell + j);
+            }
+        }
+        cell += length;
+    }
+    
+    current = index;
+    load_us = timer_get_ticks() - start;
+    return 0;
+}
+
+int level_current(void) {
+    return current;
+}
+
+const level_header_t* level_current_header(void) {
+    return current >= 0 ? level_get(current) : 0;
+}
+
+// Cells outside the grid count as walls
+int level_is_wall(int x, int y) {
+    if (x < 0 || x >= LEVEL_WIDTH || y < 0 || y >= LEVEL_HEIGHT) return 1;
+    return walls[y * LEVEL_WIDTH + x];
+}
+
+int level_wraps(void) {
+    const level_header_t* level = level_current_header();
+    return level && (level->flags & LEVEL_FLAG_WRAP);
+}
+
+// Copy the background to the screen with its top-left corner at (x, y)
+void level_draw_background(int x, int y) {
+    if (background == 0) return;
+    
+    framebuffer_t* fb = framebuffer_get();
+    uint32_t* dst = fb->buffer + y * fb->width + x;
+    const uint32_t* src = background;
+    for (int row = 0; row < BACKGROUND_HEIGHT; row++) {
+        memcpy_neon(dst, src, BACKGROUND_WIDTH * sizeof(uint32_t));
+        dst += fb->width;
+        src += BACKGROUND_WIDTH;
+    }
+    framebuffer_mark_dirty(x, y, BACKGROUND_WIDTH, BACKGROUND_HEIGHT);
+}
+
+uint32_t level_get_load_us(void) {
+    return load_us;
+}
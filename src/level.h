@@ -0,0 +1,43 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include "kernel.h"
+
+// Playfield size in cells and pixels per cell (all levels share them)
+#define LEVEL_WIDTH         40
+#define LEVEL_HEIGHT        30
+#define LEVEL_CELL_SIZE     16
+
+#define LEVEL_FLAG_WRAP     0x01    // Edges wrap around instead of killing
+
+#define LEVEL_WALL_COLOR    0xFF3050A0
+
+// Binary level as written by tools/mklevel.py, followed by rle_length run
+// bytes (bit 7 = wall, bits 0-6 = run length - 1) covering the grid in
+// row-major order. Levels sit back to back in the .levels section.
+typedef struct __attribute__((packed)) {
+    char magic[4];          // "SLV1"
+    uint16_t size;          // Whole entry, a multiple of 4
+    uint8_t width;
+    uint8_t height;
+    uint8_t spawn_x;        // Head cell
+    uint8_t spawn_y;
+    uint8_t direction;      // direction_t
+    uint8_t flags;
+    char name[16];
+    uint16_t rle_length;
+    uint16_t wall_count;
+} level_header_t;
+
+// Function declarations
+int level_count(void);
+const level_header_t* level_get(int index);
+int level_load(int index);
+int level_current(void);
+const level_header_t* level_current_header(void);
+int level_is_wall(int x, int y);
+int level_wraps(void);
+void level_draw_background(int x, int y);
+uint32_t level_get_load_us(void);
+
+#endif
@@ -0,0 +1,8 @@
+// Levels linked into the image. The .lvl files are built from levels/*.txt
+// by tools/mklevel.py, and levels.inc (one .incbin per level, sorted by
+// file name) is generated from that list by the Makefile. level.c walks
+// the .levels section entry by entry, so file name order is the level
+// numbering.
+.section .levels, "a"
+
+.include "levels.inc"
@@ -0,0 +1,155 @@
+#include "log.h"
+#include "telemetry.h"
+#include "timer.h"
+#include "uart.h"
+
+// Ring of pending entries (size must be a power of two)
+#define LOG_RING_SIZE       256
+#define LOG_RING_MASK       (LOG_RING_SIZE - 1)
+
+// Entries drained per log_drain() call, to bound main loop time
+#define LOG_DRAIN_BUDGET    16
+
+static log_entry_t log_ring[LOG_RING_SIZE];
+static volatile uint32_t log_head = 0;  // Next entry to write
+static volatile uint32_t log_tail = 0;  // Next entry to drain
+static volatile uint32_t log_lost = 0;
+static uint16_t log_sequence = 0;
+
+static const char level_tags[] = { 'D', 'I', 'W', 'E' };
+
+// Record one entry. Costs a timer read and a handful of stores, so it is
+// safe in interrupt handlers; when the ring is full the oldest entry is
+// overwritten and counted as lost.
+void log_record(uint8_t level, const char* format, uint8_t nargs, const uint32_t* args) {
+    uint32_t flags = irq_save();
+    
+    if (log_head - log_tail == LOG_RING_SIZE) {
+        log_tail++;
+        log_lost++;
+    }
+    
+    log_entry_t* entry = &log_ring[log_head & LOG_RING_MASK];
+    entry->format = (uint32_t)format;
+    entry->timestamp_us = timer_get_ticks();
+    entry->sequence = log_sequence++;
+    entry->level = level;
+    entry->nargs = nargs;
+    for (int i = 0; i < LOG_MAX_ARGS; i++) {
+        entry->args[i] = args[i];
+    }
+    log_head++;
+    
+    irq_restore(flags);
+}
+
+// Append an unsigned number in the given base
+static int format_number(char* out, uint32_t value, uint32_t base) {
+    char digits[12];
+    int count = 0;
+    
+    do {
+        uint32_t digit = value % base;
+        digits[count++] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while (value > 0);
+    
+    for (int i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+// Render an entry as a text line, e.g. "[I 12345678] Score: 10\n"
+static void format_entry(const log_entry_t* entry, char* out, int size) {
+    const char* fmt = (const char*)entry->format;
+    int pos = 0;
+    int arg = 0;
+    
+    out[pos++] = '[';
+    out[pos++] = entry->level < sizeof(level_tags) ? level_tags[entry->level] : '?';
+    out[pos++] = ' ';
+    pos += format_number(&out[pos], entry->timestamp_us, 10);
+    out[pos++] = ']';
+    out[pos++] = ' ';
+    
+    // Leave room for the longest conversion plus newline and terminator
+    while (*fmt && pos < size - 14) {
+        if (*fmt != '%') {
+            out[pos++] = *fmt++;
+            continue;
+        }
+        
+        fmt++;
+        uint32_t value = arg < entry->nargs ? entry->args[arg] : 0;
+        switch (*fmt) {
+            case 'd':
+                if ((int32_t)value < 0) {
+                    out[pos++] = '-';
+                    value = 0u - value;     // Also right for INT32_MIN
+                }
+                pos += format_number(&out[pos], value, 10);
+                arg++;
+                break;
+            case 'u':
+                pos += format_number(&out[pos], value, 10);
+                arg++;
+                break;
+            case 'x':
+                pos += format_number(&out[pos], value, 16);
+                arg++;
+                break;
+            case 'c':
+                out[pos++] = (char)value;
+                arg++;
+                break;
+            case '%':
+                out[pos++] = '%';
+                break;
+            default:
+                out[pos++] = '%';
+                if (*fmt == '\0') continue;
+                out[pos++] = *fmt;
+                break;
+        }
+        fmt++;
+    }
+    
+    out[pos++] = '\n';
+    out[pos] = '\0';
+}
+
+// Format pending entries from the main loop. With telemetry enabled the
+// raw entries go out as binary records for host-side formatting;
+// otherwise they are formatted here as console text.
+void log_drain(void) {
+    for (int budget = LOG_DRAIN_BUDGET; budget > 0; budget--) {
+        uint32_t flags = irq_save();
+        if (log_tail == log_head) {
+            irq_restore(flags);
+            return;
+        }
+        log_entry_t entry = log_ring[log_tail & LOG_RING_MASK];
+        irq_restore(flags);
+        
+        if (telemetry_is_enabled()) {
+            // Leave the entry queued if the TX ring is full
+            if (telemetry_send(TELEMETRY_LOG, &entry, sizeof(entry)) != 0) return;
+        } else {
+            char line[128];
+            format_entry(&entry, line, sizeof(line));
+            uart_puts(line);
+        }
+        
+        // Only consume the entry if the producer has not overwritten it
+        flags = irq_save();
+        if (log_ring[log_tail & LOG_RING_MASK].sequence == entry.sequence) {
+            log_tail++;
+        }
+        irq_restore(flags);
+    }
+}
+
+uint32_t log_get_lost(void) {
+    return log_lost;
+}
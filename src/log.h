@@ -0,0 +1,83 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include "kernel.h"
+
+// Deferred logging: call sites store a format-string ID plus up to four
+// raw 32-bit arguments in a RAM ring. Formatting happens later from the
+// main loop (log_drain), either on target as text or on the host from the
+// binary telemetry records (tools/logdecode.py reads the strings from
+// the .logstr section of kernel.elf). Only %d %u %x %c and %% are allowed,
+// since arguments are captured by value.
+
+#define LOG_LEVEL_DEBUG     0
+#define LOG_LEVEL_INFO      1
+#define LOG_LEVEL_WARN      2
+#define LOG_LEVEL_ERROR     3
+#define LOG_LEVEL_NONE      4
+
+// Levels below LOG_MIN_LEVEL compile out entirely
+#ifndef LOG_MIN_LEVEL
+#if defined(RELEASE)
+#define LOG_MIN_LEVEL       LOG_LEVEL_WARN
+#elif defined(DEBUG)
+#define LOG_MIN_LEVEL       LOG_LEVEL_DEBUG
+#else
+#define LOG_MIN_LEVEL       LOG_LEVEL_INFO
+#endif
+#endif
+
+#define LOG_MAX_ARGS        4
+
+// Ring entry (also the binary telemetry payload, little endian). The
+// fields are naturally aligned, so the layout has no padding and entry
+// copies stay word-sized.
+typedef struct {
+    uint32_t format;        // Address of the format string in .logstr
+    uint32_t timestamp_us;
+    uint16_t sequence;      // Lets the host spot overwritten entries
+    uint8_t level;
+    uint8_t nargs;
+    uint32_t args[LOG_MAX_ARGS];
+} log_entry_t;
+
+// Argument counting (0-4 arguments)
+#define LOG_NARGS_(_0, _1, _2, _3, _4, n, ...) n
+#define LOG_NARGS(...) LOG_NARGS_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+
+#define LOG_AT(level, fmt, ...) do { \
+    static const char log_fmt_[] __attribute__((section(".logstr"))) = fmt; \
+    log_record((level), log_fmt_, LOG_NARGS(__VA_ARGS__), \
+               (const uint32_t[LOG_MAX_ARGS]){ __VA_ARGS__ }); \
+} while (0)
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) do { } while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, ...) LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) do { } while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(fmt, ...) LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) do { } while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) do { } while (0)
+#endif
+
+// Function declarations
+void log_record(uint8_t level, const char* format, uint8_t nargs, const uint32_t* args);
+void log_drain(void);
+uint32_t log_get_lost(void);
+
+#endif
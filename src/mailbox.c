@@ -0,0 +1,241 @@
+#include "mailbox.h"
+#include "timer.h"
+#include "uart.h"
+#include "console.h"
+#include "mmu.h"
+
+// Mailbox registers
+#define MAILBOX_READ    (MAILBOX_BASE + 0x00)
+#define MAILBOX_STATUS  (MAILBOX_BASE + 0x18)
+#define MAILBOX_WRITE   (MAILBOX_BASE + 0x20)
+
+// Mailbox status bits
+#define MAILBOX_EMPTY   0x40000000
+#define MAILBOX_FULL    0x80000000
+
+// Buffer and tag codes
+#define MAILBOX_REQUEST         0x00000000
+#define MAILBOX_RESPONSE_OK     0x80000000
+#define MAILBOX_TAG_RESPONSE    0x80000000
+
+// ARM to VideoCore bus address alias for buffers handed to the GPU
+#define MAILBOX_BUS_ALIAS       0x40000000
+
+// Batch states
+#define BATCH_BUILDING  0
+#define BATCH_PENDING   1
+#define BATCH_COMPLETE  2
+#define BATCH_FAILED    3
+
+// Only one property request is in flight at a time, so a response can be
+// matched to its batch by address
+static mailbox_batch_t* in_flight = 0;
+static uint32_t timeouts = 0;
+
+void mailbox_batch_begin(mailbox_batch_t* batch) {
+    batch->words[0] = 0;
+    batch->words[1] = MAILBOX_REQUEST;
+    batch->length = 2;
+    batch->state = BATCH_BUILDING;
+}
+
+// Append a tag with a value buffer of 'value_bytes' (large enough for both
+// request and response). Returns the zeroed value buffer to fill in and to
+// read the response from, or 0 if the batch is full.
+uint32_t* mailbox_batch_add(mailbox_batch_t* batch, uint32_t tag, uint32_t value_bytes) {
+    uint32_t value_words = (value_bytes + 3) / 4;
+    
+    // Tag header (3 words), value, and room for the end tag
+    if (batch->state != BATCH_BUILDING ||
+        batch->length + 3 + value_words + 1 > MAILBOX_BATCH_WORDS) {
+        return 0;
+    }
+    
+    uint32_t* words = batch->words + batch->length;
+    words[0] = tag;
+    words[1] = value_words * 4;
+    words[2] = MAILBOX_REQUEST;
+    for (uint32_t i = 0; i < value_words; i++) {
+        words[3 + i] = 0;
+    }
+    
+    batch->length += 3 + value_words;
+    return words + 3;
+}
+
+// The firmware sets bit 31 of a tag's code word when it handled the tag
+int mailbox_tag_ok(const uint32_t* value) {
+    return value && (value[-1] & MAILBOX_TAG_RESPONSE);
+}
+
+static uint32_t bus_address(const mailbox_batch_t* batch) {
+    return (uint32_t)batch->words + MAILBOX_BUS_ALIAS;
+}
+
+// Hand the batch to the GPU without waiting for the answer. Returns -1 if
+// another request is still in flight or the mailbox is full.
+int mailbox_submit(mailbox_batch_t* batch) {
+    if (in_flight || batch->state != BATCH_BUILDING) {
+        return -1;
+    }
+    if (mmio_read(MAILBOX_STATUS) & MAILBOX_FULL) {
+        return -1;
+    }
+    
+    batch->words[batch->length] = 0;                // End tag
+    batch->words[0] = (batch->length + 1) * 4;
+    batch->words[1] = MAILBOX_REQUEST;
+    // The GPU reads RAM directly: push the request out of the data cache
+    dcache_clean_range(batch->words, sizeof(batch->words));
+    
+    batch->state = BATCH_PENDING;
+    batch->submitted_at = timer_get_ticks();
+    in_flight = batch;
+    // Full barrier access: the request must be in RAM before the doorbell
+    mmio_write(MAILBOX_WRITE, bus_address(batch) | MAILBOX_CHANNEL_PROP);
+    return 0;
+}
+
+// Collect the response if it has arrived. Returns MAILBOX_PENDING until then,
+// MAILBOX_DONE once the firmware accepted the batch and MAILBOX_ERROR if it
+// rejected it or did not answer within MAILBOX_TIMEOUT_US. Replies to
+// requests that already timed out are discarded.
+int mailbox_poll(mailbox_batch_t* batch) {
+    if (batch->state == BATCH_PENDING) {
+        int answered = 0;
+        peripheral_enter();
+        while (!(mmio_read_relaxed(MAILBOX_STATUS) & MAILBOX_EMPTY)) {
+            uint32_t data = mmio_read_relaxed(MAILBOX_READ);
+            if ((data & 0xF) != MAILBOX_CHANNEL_PROP || in_flight == 0) continue;
+            if ((data & ~0xF) != bus_address(in_flight)) continue;
+            answered = 1;
+            break;
+        }
+        peripheral_exit(); // Orders the mailbox read before reading the reply
+        
+        if (answered) {
+            dcache_invalidate_range(in_flight->words, sizeof(in_flight->words));
+            in_flight->state = in_flight->words[1] == MAILBOX_RESPONSE_OK ?
+                BATCH_COMPLETE : BATCH_FAILED;
+            in_flight = 0;
+        }
+        
+        if (batch->state == BATCH_PENDING &&
+            timer_get_ticks() - batch->submitted_at > MAILBOX_TIMEOUT_US) {
+            batch->state = BATCH_FAILED;
+            if (in_flight == batch) {
+                in_flight = 0;
+            }
+            timeouts++;
+        }
+    }
+    
+    switch (batch->state) {
+        case BATCH_PENDING:  return MAILBOX_PENDING;
+        case BATCH_COMPLETE: return MAILBOX_DONE;
+        default:             return MAILBOX_ERROR;
+    }
+}
+
+// Blocking round trip, bounded by MAILBOX_TIMEOUT_US for each stage.
+// Returns 0 if the firmware processed the batch, -1 otherwise.
+int mailbox_call(mailbox_batch_t* batch) {
+    uint32_t start = timer_get_ticks();
+    
+    // Let an outstanding asynchronous request finish first
+    while (in_flight && mailbox_poll(in_flight) == MAILBOX_PENDING) {
+    }
+    
+    while (mailbox_submit(batch) != 0) {
+        if (timer_get_ticks() - start > MAILBOX_TIMEOUT_US) {
+            timeouts++;
+            return -1;
+        }
+    }
+    
+    int result;
+    while ((result = mailbox_poll(batch)) == MAILBOX_PENDING) {
+    }
+    return result == MAILBOX_DONE ? 0 : -1;
+}
+
+uint32_t mailbox_get_timeouts(void) {
+    return timeouts;
+}
+
+static void print_value(const char* name, const uint32_t* value, uint32_t word) {
+    uart_puts(name);
+    if (mailbox_tag_ok(value)) {
+        uart_dec(value[word]);
+    } else {
+        uart_puts("n/a");
+    }
+    uart_puts("\n");
+}
+
+static void print_hex_value(const char* name, const uint32_t* value, uint32_t word) {
+    uart_puts(name);
+    if (mailbox_tag_ok(value)) {
+        uart_hex(value[word]);
+    } else {
+        uart_puts("n/a");
+    }
+    uart_puts("\n");
+}
+
+static uint32_t* add_clock(mailbox_batch_t* batch, uint32_t tag, uint32_t clock) {
+    uint32_t* value = mailbox_batch_add(batch, tag, 8);
+    if (value) {
+        value[0] = clock;
+    }
+    return value;
+}
+
+// Board information, all in one round trip
+static void cmd_board(int argc, char** argv) {
+    static mailbox_batch_t batch;
+    (void)argc;
+    (void)argv;
+    
+    mailbox_batch_begin(&batch);
+    uint32_t* firmware = mailbox_batch_add(&batch, MAILBOX_TAG_GET_FIRMWARE_REVISION, 4);
+    uint32_t* model = mailbox_batch_add(&batch, MAILBOX_TAG_GET_BOARD_MODEL, 4);
+    uint32_t* revision = mailbox_batch_add(&batch, MAILBOX_TAG_GET_BOARD_REVISION, 4);
+    uint32_t* arm_memory = mailbox_batch_add(&batch, MAILBOX_TAG_GET_ARM_MEMORY, 8);
+    uint32_t* vc_memory = mailbox_batch_add(&batch, MAILBOX_TAG_GET_VC_MEMORY, 8);
+    uint32_t* arm_clock = add_clock(&batch, MAILBOX_TAG_GET_CLOCK_RATE, MAILBOX_CLOCK_ARM);
+    uint32_t* arm_max = add_clock(&batch, MAILBOX_TAG_GET_MAX_CLOCK_RATE, MAILBOX_CLOCK_ARM);
+    uint32_t* core_clock = add_clock(&batch, MAILBOX_TAG_GET_CLOCK_RATE, MAILBOX_CLOCK_CORE);
+    uint32_t* emmc_clock = add_clock(&batch, MAILBOX_TAG_GET_CLOCK_RATE, MAILBOX_CLOCK_EMMC);
+    uint32_t* temperature = mailbox_batch_add(&batch, MAILBOX_TAG_GET_TEMPERATURE, 8);
+    uint32_t* max_temperature = mailbox_batch_add(&batch, MAILBOX_TAG_GET_MAX_TEMPERATURE, 8);
+    
+    uint32_t start = timer_get_ticks();
+    if (mailbox_call(&batch) != 0) {
+        uart_puts("Mailbox request failed\n");
+        return;
+    }
+    uint32_t elapsed = timer_get_ticks() - start;
+    
+    print_hex_value("firmware:      ", firmware, 0);
+    print_hex_value("board model:   ", model, 0);
+    print_hex_value("revision:      ", revision, 0);
+    print_hex_value("arm mem base:  ", arm_memory, 0);
+    print_hex_value("arm mem size:  ", arm_memory, 1);
+    print_hex_value("vc mem base:   ", vc_memory, 0);
+    print_hex_value("vc mem size:   ", vc_memory, 1);
+    print_value("arm clock Hz:  ", arm_clock, 1);
+    print_value("arm max Hz:    ", arm_max, 1);
+    print_value("core clock Hz: ", core_clock, 1);
+    print_value("emmc clock Hz: ", emmc_clock, 1);
+    print_value("temp mC:       ", temperature, 1);
+    print_value("max temp mC:   ", max_temperature, 1);
+    
+    uart_puts("round trip us: ");
+    uart_dec(elapsed);
+    uart_puts("\n");
+}
+
+void mailbox_register_console(void) {
+    console_register_command("board", cmd_board, "firmware, board, memory, clocks, temperature");
+}
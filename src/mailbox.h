@@ -0,0 +1,69 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include "kernel.h"
+
+// VideoCore mailbox property interface. A batch packs any number of tags
+// into one aligned buffer so they cost a single round trip:
+//
+//     mailbox_batch_t batch;
+//     mailbox_batch_begin(&batch);
+//     uint32_t* temp = mailbox_batch_add(&batch, MAILBOX_TAG_GET_TEMPERATURE, 8);
+//     temp[0] = 0;                             // sensor id
+//     if (mailbox_call(&batch) == 0 && mailbox_tag_ok(temp)) ... temp[1] ...
+//
+// mailbox_submit()/mailbox_poll() run the same batch without blocking.
+
+#define MAILBOX_CHANNEL_PROP    8
+#define MAILBOX_BATCH_WORDS     128
+#define MAILBOX_TIMEOUT_US      100000
+
+// Property tags
+#define MAILBOX_TAG_GET_FIRMWARE_REVISION   0x00000001
+#define MAILBOX_TAG_GET_BOARD_MODEL         0x00010001
+#define MAILBOX_TAG_GET_BOARD_REVISION      0x00010002
+#define MAILBOX_TAG_GET_BOARD_SERIAL        0x00010004
+#define MAILBOX_TAG_GET_ARM_MEMORY          0x00010005
+#define MAILBOX_TAG_GET_VC_MEMORY           0x00010006
+#define MAILBOX_TAG_GET_CLOCK_RATE          0x00030002
+#define MAILBOX_TAG_GET_MAX_CLOCK_RATE      0x00030004
+#define MAILBOX_TAG_GET_TEMPERATURE         0x00030006
+#define MAILBOX_TAG_GET_MAX_TEMPERATURE     0x0003000A
+#define MAILBOX_TAG_ALLOCATE_BUFFER         0x00040001
+#define MAILBOX_TAG_GET_PITCH               0x00040008
+#define MAILBOX_TAG_SET_PHYSICAL_SIZE       0x00048003
+#define MAILBOX_TAG_SET_VIRTUAL_SIZE        0x00048004
+#define MAILBOX_TAG_SET_DEPTH               0x00048005
+#define MAILBOX_TAG_SET_VIRTUAL_OFFSET      0x00048009
+#define MAILBOX_TAG_SET_PALETTE             0x0004800B
+#define MAILBOX_TAG_WAIT_FOR_VSYNC          0x0004800E
+
+// Clock ids for the clock rate tags
+#define MAILBOX_CLOCK_EMMC      1
+#define MAILBOX_CLOCK_UART      2
+#define MAILBOX_CLOCK_ARM       3
+#define MAILBOX_CLOCK_CORE      4
+
+// mailbox_poll() results
+#define MAILBOX_DONE            0
+#define MAILBOX_PENDING         1
+#define MAILBOX_ERROR           (-1)
+
+typedef struct {
+    uint32_t words[MAILBOX_BATCH_WORDS];    // Size, code, tags..., end tag
+    uint32_t length;                        // Words used, excluding end tag
+    volatile int state;
+    uint32_t submitted_at;
+} __attribute__((aligned(64))) mailbox_batch_t;  // Own cache lines; GPU needs 16
+
+// Function declarations
+void mailbox_batch_begin(mailbox_batch_t* batch);
+uint32_t* mailbox_batch_add(mailbox_batch_t* batch, uint32_t tag, uint32_t value_bytes);
+int mailbox_call(mailbox_batch_t* batch);
+int mailbox_submit(mailbox_batch_t* batch);
+int mailbox_poll(mailbox_batch_t* batch);
+int mailbox_tag_ok(const uint32_t* value);
+uint32_t mailbox_get_timeouts(void);
+void mailbox_register_console(void);
+
+#endif
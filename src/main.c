@@ -6,31 +6,233 @@
 #include "interrupts.h"
 #include "snake.h"
 #include "graphics.h"
+#include "telemetry.h"
+#include "capture.h"
+#include "log.h"
+#include "console.h"
+#include "fiq.h"
+#include "pmu.h"
+#include "profile.h"
+#include "frameprof.h"
+#include "sampler.h"
+#include "memory.h"
+#include "mailbox.h"
+#include "mmu.h"
+#include "level.h"
+#include "storage.h"
+#include "particles.h"
+#ifdef BENCH_KERNEL
+#include "bench.h"
+#endif
+
+// Display frame period of the smooth render mode (60 Hz)
+#define SMOOTH_FRAME_US     16667
+
+// Logic steps run back to back after a stall before the loop resyncs
+#define MAX_CATCHUP_STEPS   4
+
+// Game logic period, adjustable at runtime with "set tick <ms>"
+static volatile int tick_ms = 100;
+static volatile int tickless_mode = 0;
+static volatile int shadow_mode = 1;
+static volatile int vsync_mode = 0;
+static uint32_t frames = 0;
+static int game_recorded = 0;
+
+static void print_counter(const char* name, uint32_t value) {
+    uart_puts(name);
+    uart_dec(value);
+    uart_puts("\n");
+}
+
+static void cmd_stats(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    
+    print_counter("frames:        ", frames);
+    print_counter("tick ms:       ", tick_ms);
+    print_counter("timer irqs:    ", interrupts_get_count(IRQ_TIMER_1));
+    print_counter("uart irqs:     ", interrupts_get_count(IRQ_UART));
+    print_counter("spurious irqs: ", interrupts_get_spurious());
+    print_counter("tx dropped:    ", uart_get_tx_dropped());
+    print_counter("telemetry drop:", telemetry_get_dropped());
+    print_counter("log lost:      ", log_get_lost());
+}
+
+static void cmd_irqstat(int argc, char** argv) {
+    if (argc == 2 && console_arg_is(argv[1], "reset")) {
+        interrupts_reset_stats();
+        uart_puts("IRQ statistics reset\n");
+        return;
+    }
+    
+    interrupts_print_stats();
+    print_counter("missed ticks: ", timer_get_missed_ticks());
+    print_counter("sleep wakeups:", timer_get_sleep_wakeups());
+}
+
+static void cmd_telemetry(int argc, char** argv) {
+    if (argc == 2) {
+        telemetry_set_enabled(console_arg_is(argv[1], "on"));
+    }
+    uart_puts(telemetry_is_enabled() ? "telemetry on\n" : "telemetry off\n");
+}
+
+static void cmd_capture(int argc, char** argv) {
+    if (argc == 1) {
+        capture_request(0);
+    } else if (console_arg_is(argv[1], "full")) {
+        capture_request(1);
+    } else if (console_arg_is(argv[1], "every") && argc == 3) {
+        capture_set_interval(console_arg_number(argv[2]));
+    } else {
+        uart_puts("Usage: capture [full | every <frames>]\n");
+    }
+}
+
+static void cmd_fiq(int argc, char** argv) {
+    if (argc == 2) {
+        fiq_route(console_arg_is(argv[1], "gpio") ? FIQ_SOURCE_GPIO_BUTTONS : FIQ_SOURCE_NONE);
+    }
+    uart_puts(fiq_get_source() == FIQ_SOURCE_GPIO_BUTTONS ? "FIQ: gpio buttons\n" : "FIQ: off\n");
+    print_counter("fiq dropped: ", fiq_get_dropped());
+}
+
+static void cmd_prof(int argc, char** argv) {
+    if (argc == 2 && console_arg_is(argv[1], "reset")) {
+        profile_reset();
+        uart_puts("Profile counters reset\n");
+        return;
+    }
+    
+    if (!PROFILE_ENABLED) {
+        uart_puts("Profiling is compiled out in this build\n");
+        return;
+    }
+    profile_print();
+}
+
+static void cmd_mem(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    memory_print_stats();
+}
+
+// Append each finished game and its replay to the card once
+static void record_finished_game(void) {
+    const snake_game_t* state = snake_get_state();
+    if (!state->game_over) {
+        game_recorded = 0;
+        return;
+    }
+    if (game_recorded) return;
+    
+    const level_header_t* level = level_current_header();
+    const char* name = level ? level->name : "";
+    storage_record_game(state->score, state->snake_length, name);
+    storage_record_replay(snake_get_replay(), state->score, name);
+    game_recorded = 1;
+}
+
+// Smooth mode: run the logic steps that are due and return how far 'now'
+// is into the current step (Q8). After a long stall the schedule restarts
+// from now instead of replaying every missed step.
+static uint32_t step_logic(uint32_t now, uint32_t step_us, uint32_t* next_step) {
+    int stepped = 0;
+    while ((int32_t)(now - *next_step) >= 0) {
+        if (stepped++ == MAX_CATCHUP_STEPS) {
+            *next_step = now + step_us;
+            break;
+        }
+        snake_update();
+        *next_step += step_us;
+    }
+    
+    uint32_t remaining = *next_step - now;
+    if (remaining > step_us) {
+        // The tick was shortened at runtime
+        remaining = step_us;
+        *next_step = now + step_us;
+    }
+    return ((step_us - remaining) << SNAKE_PROGRESS_SHIFT) / step_us;
+}
+
+static void shadow_changed(int value) {
+    framebuffer_set_shadow(value);
+    shadow_mode = framebuffer_shadow_enabled();
+}
+
+static void tickless_changed(int value) {
+    timer_set_tickless(value);
+}
+
+static void console_setup(void) {
+    console_init();
+    console_register_command("stats", cmd_stats, "print runtime counters");
+    console_register_command("irqstat", cmd_irqstat, "[reset] - IRQ latency/duration histograms");
+    console_register_command("fiq", cmd_fiq, "[gpio|off] - route button input to FIQ");
+    console_register_command("prof", cmd_prof, "[reset] - PMU cycles/events per profiled region");
+    console_register_command("mem", cmd_mem, "arena and pool usage with high-water marks");
+    console_register_command("telemetry", cmd_telemetry, "[on|off] - binary telemetry stream");
+    console_register_command("capture", cmd_capture, "[full | every <frames>] - screen capture");
+    console_register_var("tick", &tick_ms, 10, 1000, 0);
+    console_register_var("tickless", &tickless_mode, 0, 1, tickless_changed);
+    console_register_var("shadow", &shadow_mode, 0, 1, shadow_changed);
+    console_register_var("vsync", &vsync_mode, 0, 1, 0);
+    snake_register_console();
+    frameprof_register_console();
+    sampler_register_console();
+    mailbox_register_console();
+    storage_register_console();
+    particles_register_console();
+}
 
 void kernel_main(void) {
     // Initialize UART for debugging
     uart_init();
     uart_puts("RPi2 Snake OS Starting...\n");
-
+    
+    // Start the cycle and event counters before anything is profiled
+    pmu_init();
+    
+    // Hand the heap to the arenas before anything allocates
+    memory_init();
+    
     // Initialize framebuffer
     if (framebuffer_init() != 0) {
         uart_puts("Failed to initialize framebuffer\n");
+        uart_flush();
         while (1);
     }
     uart_puts("Framebuffer initialized\n");
-
+    
+    // Caches on: RAM write-back, GPU memory (framebuffer) write-combined
+    mmu_init();
+    framebuffer_t* fb = framebuffer_get();
+    mmu_map_region((uint32_t)framebuffer_get_hw_buffer(), fb->size, MMU_NORMAL_UNCACHED);
+    uart_puts(framebuffer_shadow_enabled() ? "MMU and caches enabled, shadow framebuffer\n"
+                                           : "MMU and caches enabled\n");
+    
     // Initialize GPIO
     gpio_init();
     uart_puts("GPIO initialized\n");
-
+    
     // Initialize timer
     timer_init();
     uart_puts("Timer initialized\n");
-
+    
     // Initialize interrupt system
     interrupts_init();
     uart_puts("Interrupts initialized\n");
 
+#ifdef BENCH_KERNEL
+    // Benchmark kernel: measure, report, halt
+    bench_run();
+    while (1) {
+        __asm__("wfi");
+    }
+#endif
+    
     // Clear screen
     graphics_clear_screen(COLOR_BLACK);
     
@@ -40,20 +242,132 @@ void kernel_main(void) {
     graphics_draw_text("W=Up A=Left S=Down D=Right", 10, 50, COLOR_YELLOW);
     
     // Wait a bit
+    framebuffer_flush();
     timer_sleep(2000);
     
+    if (particles_init() != 0) {
+        uart_puts("Out of memory for particles, effects disabled\n");
+    }
+    
+    // SD card for scores; the game runs without one
+    if (storage_init() == 0) {
+        uart_puts("SD card ready, best score ");
+        uart_dec(storage_get_best_score());
+        uart_puts("\n");
+    } else {
+        uart_puts("No SD card, scores will not be saved\n");
+    }
+    
     // Initialize and start snake game
+    shadow_mode = framebuffer_shadow_enabled();
+    console_setup();
     snake_init();
     uart_puts("Snake game initialized\n");
-    uart_puts("Game starting! Use WASD keys via UART\n");
+    uart_puts("Game starting! Use WASD keys via UART, ESC for commands\n");
     
     // Main game loop
+    uint32_t next_frame = timer_get_ticks();
+    uint32_t next_step = next_frame;
     while (1) {
-        snake_update();
+        frameprof_frame_start();
+        memory_frame_reset();
+        uint32_t frame_start = timer_get_ticks();
+        
+        // Button presses captured by the FIQ fast path
+        uint32_t pins;
+        while (fiq_pop(&pins)) {
+            snake_handle_button_events(pins);
+        }
+        frameprof_mark(FRAME_PHASE_INPUT);
+        
+        // Logic runs once per frame, except in the smooth mode where frames
+        // come at 60 Hz and logic keeps its own step deadline
+        int smooth = snake_get_render_mode() == SNAKE_RENDER_SMOOTH;
+        uint32_t step_us = tick_ms * 1000;
+        uint32_t frame_us = smooth ? SMOOTH_FRAME_US : step_us;
+        if (smooth) {
+            snake_set_progress(step_logic(frame_start, step_us, &next_step));
+        } else {
+            snake_update();
+            next_step = frame_start + step_us;
+        }
+        particles_update(frame_start);
+        uint32_t update_end = timer_get_ticks();
+        frameprof_mark(FRAME_PHASE_UPDATE);
+        
+        // Overlays sit on top: lift last frame's off, newest first, before
+        // the game draws
+        frameprof_erase_hud();
+        particles_erase();
         snake_draw();
+        particles_draw();
+        uint32_t draw_end = timer_get_ticks();
+        frameprof_mark(FRAME_PHASE_DRAW);
+        
+        // Present: overlays and everything that ships the frame out
+        frameprof_set_budget(frame_us);
+        frameprof_draw_hud();
+        
+        // With vsync the frame is paced by the display: wait for the blank
+        // (counted as idle), then ship the dirty tiles
+        int wait_vsync = smooth && vsync_mode;
+        if (wait_vsync) {
+            frameprof_mark(FRAME_PHASE_PRESENT);
+            if (framebuffer_wait_vsync() != 0) {
+                vsync_mode = 0;
+                wait_vsync = 0;
+                uart_puts("No vsync from the firmware, pacing with the timer\n");
+            }
+            frameprof_mark(FRAME_PHASE_IDLE);
+        }
+        framebuffer_flush();
+        
+        // Report frame timing on the binary telemetry channel and to the card
+        const snake_game_t* state = snake_get_state();
+        telemetry_frame_stats_t stats = {
+            .tick = frames,
+            .timestamp_us = draw_end,
+            .update_us = update_end - frame_start,
+            .draw_us = draw_end - update_end,
+            .score = state->score,
+            .length = state->snake_length,
+            .flags = state->game_over ? TELEMETRY_FLAG_GAME_OVER : 0,
+            .irq_timer = interrupts_get_count(IRQ_TIMER_1),
+            .irq_uart = interrupts_get_count(IRQ_UART),
+            .tx_dropped = uart_get_tx_dropped()
+        };
+        if (telemetry_is_enabled()) {
+            telemetry_send_frame_stats(&stats);
+        }
+        storage_record_telemetry(&stats);
+        frames++;
+        
+        // Results are only staged in RAM here; the card is touched in idle
+        record_finished_game();
+        
+        // Stream a screen capture if one was requested
+        capture_service();
+        
+        // Format deferred log entries outside the hot path
+        log_drain();
+        
+        // Run console commands entered since the last frame
+        console_poll();
+        frameprof_mark(FRAME_PHASE_PRESENT);
+        
+        // Game runs at ~10 FPS by default, 60 in the smooth mode. Sleep to
+        // an absolute deadline so the frame period does not stretch by the
+        // time spent in the frame; if we are already late, start the next
+        // period from now.
+        next_frame += frame_us;
+        if (wait_vsync || (int32_t)(next_frame - timer_get_ticks()) <= 0) {
+            next_frame = timer_get_ticks();
+        }
         
-        // Game runs at ~10 FPS
-        timer_sleep(100);
+        // Idle time: write back cached SD blocks. With vsync the next frame
+        // starts right away, so borrow up to this frame's own period.
+        storage_idle(wait_vsync ? frame_start + frame_us : next_frame);
+        timer_sleep_until(next_frame);
     }
 }
 
@@ -62,11 +376,13 @@ void panic(const char* message) {
     uart_puts("KERNEL PANIC: ");
     uart_puts(message);
     uart_puts("\n");
+    uart_flush(); // Interrupts may never run again
     
     // Try to display on screen too
     graphics_clear_screen(COLOR_RED);
     graphics_draw_text("KERNEL PANIC", 10, 10, COLOR_WHITE);
     graphics_draw_text(message, 10, 30, COLOR_WHITE);
+    framebuffer_flush();
     
     // Halt
     while (1) {
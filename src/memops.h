@@ -0,0 +1,18 @@
+#ifndef MEMOPS_H
+#define MEMOPS_H
+
+#include "kernel.h"
+
+// Memory routines in src/memops.s. The compiler also calls memcpy/memset
+// on its own for struct copies and simple loops.
+
+// Function declarations
+void* memcpy(void* dst, const void* src, size_t n);
+void* memmove(void* dst, const void* src, size_t n);
+void* memset(void* dst, int c, size_t n);
+void memset32(uint32_t* dst, uint32_t value, uint32_t count);
+
+// NEON bulk copy: uses d0-d7, never call from interrupt context
+void* memcpy_neon(void* dst, const void* src, size_t n);
+
+#endif
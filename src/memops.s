@@ -0,0 +1,253 @@
+.syntax unified
+.section .text
+.fpu neon
+
+// Freestanding memory routines for the Cortex-A7. GCC emits calls to
+// memcpy/memset/memmove for struct copies and recognised loops even with
+// -ffreestanding, and the EABI helpers cover other compilers.
+//
+// memcpy, memmove, memset and memset32 only use integer registers, so
+// they are safe in interrupt handlers (vectors.s does not save NEON
+// state). memcpy_neon is for large copies from the main loop only.
+
+// void* memcpy(void* dst, const void* src, size_t n)
+.global memcpy
+memcpy:
+    push {r0, r4-r9, lr}
+    cmp r2, #16
+    blo copy_bytes
+
+    // Align the destination to a word
+    ands r3, r0, #3
+    beq 1f
+    rsb r3, r3, #4
+    sub r2, r2, r3
+0:
+    ldrb ip, [r1], #1
+    strb ip, [r0], #1
+    subs r3, r3, #1
+    bne 0b
+1:
+    ands r3, r1, #3
+    bne copy_shifted
+
+    // Both aligned: 32 bytes per LDM/STM pair
+    subs r2, r2, #32
+    blo 3f
+2:
+    pld [r1, #64]
+    ldmia r1!, {r3-r9, ip}
+    stmia r0!, {r3-r9, ip}
+    subs r2, r2, #32
+    bhs 2b
+3:
+    adds r2, r2, #32
+    beq copy_done
+copy_words:
+    subs r2, r2, #4
+    ldrhs r3, [r1], #4
+    strhs r3, [r0], #4
+    bhs copy_words
+    add r2, r2, #4
+copy_bytes:
+    subs r2, r2, #1
+    ldrbhs r3, [r1], #1
+    strbhs r3, [r0], #1
+    bhs copy_bytes
+copy_done:
+    pop {r0, r4-r9, pc}
+
+    // Source off by 1-3 bytes from the (aligned) destination: load aligned
+    // words and merge neighbours with shifts instead of byte copies, which
+    // also keeps strongly-ordered memory (MMU off) free of unaligned loads
+copy_shifted:
+    bic r1, r1, #3
+    ldr r4, [r1], #4
+    cmp r3, #2
+    beq copy_shift_2
+    bhi copy_shift_3
+
+.macro copy_shift offset
+    subs r2, r2, #4
+    blo 2f
+1:
+    ldr r5, [r1], #4
+    lsr r6, r4, #(8 * \offset)
+    orr r6, r6, r5, lsl #(32 - 8 * \offset)
+    str r6, [r0], #4
+    mov r4, r5
+    subs r2, r2, #4
+    bhs 1b
+2:
+    add r2, r2, #4
+    sub r1, r1, #(4 - \offset)
+    b copy_bytes
+.endm
+
+copy_shift_1:
+    copy_shift 1
+copy_shift_2:
+    copy_shift 2
+copy_shift_3:
+    copy_shift 3
+
+// void* memmove(void* dst, const void* src, size_t n)
+// Forward copies go through memcpy; an overlapping move to a higher
+// address copies from the end down.
+.global memmove
+memmove:
+    sub r3, r0, r1
+    cmp r3, r2
+    bhs memcpy                  // dst < src (wraps) or no overlap
+
+    push {r0, r4-r9, lr}
+    add r0, r0, r2
+    add r1, r1, r2
+
+    // Word copies only when both ends line up
+    eor r3, r0, r1
+    tst r3, #3
+    bne move_bytes
+0:
+    tst r0, #3
+    beq 1f
+    subs r2, r2, #1
+    blo move_done
+    ldrb r3, [r1, #-1]!
+    strb r3, [r0, #-1]!
+    b 0b
+1:
+    subs r2, r2, #32
+    blo 3f
+2:
+    ldmdb r1!, {r3-r9, ip}
+    stmdb r0!, {r3-r9, ip}
+    subs r2, r2, #32
+    bhs 2b
+3:
+    add r2, r2, #32
+4:
+    subs r2, r2, #4
+    ldrhs r3, [r1, #-4]!
+    strhs r3, [r0, #-4]!
+    bhs 4b
+    add r2, r2, #4
+move_bytes:
+    subs r2, r2, #1
+    ldrbhs r3, [r1, #-1]!
+    strbhs r3, [r0, #-1]!
+    bhs move_bytes
+move_done:
+    pop {r0, r4-r9, pc}
+
+// void* memset(void* dst, int c, size_t n)
+.global memset
+memset:
+    mov ip, r0
+    and r1, r1, #0xFF
+    orr r1, r1, r1, lsl #8
+    orr r1, r1, r1, lsl #16
+    cmp r2, #16
+    blo set_bytes
+0:
+    tst ip, #3
+    beq set_words
+    strb r1, [ip], #1
+    sub r2, r2, #1
+    b 0b
+set_words:
+    push {r4, lr}
+    mov r3, r1
+    mov r4, r1
+    mov lr, r1
+    subs r2, r2, #32
+    blo 2f
+1:
+    stmia ip!, {r1, r3, r4, lr}
+    stmia ip!, {r1, r3, r4, lr}
+    subs r2, r2, #32
+    bhs 1b
+2:
+    adds r2, r2, #32
+    beq 4f
+    tst r2, #16
+    stmiane ip!, {r1, r3, r4, lr}
+    tst r2, #8
+    stmiane ip!, {r1, r3}
+    tst r2, #4
+    strne r1, [ip], #4
+    and r2, r2, #3
+4:
+    pop {r4, lr}
+set_bytes:
+    subs r2, r2, #1
+    strbhs r1, [ip], #1
+    bhs set_bytes
+    bx lr
+
+// void memset32(uint32_t* dst, uint32_t value, uint32_t count)
+// Fill 'count' words at a word-aligned 'dst' (pixel spans, clears)
+.global memset32
+memset32:
+    lsls r2, r2, #2
+    bxeq lr
+    mov ip, r0
+    b set_words
+
+// void* memcpy_neon(void* dst, const void* src, size_t n)
+// 64 bytes per iteration through NEON with software prefetch; any
+// alignment on normal memory. Clobbers d0-d7, so main-loop use only.
+.global memcpy_neon
+memcpy_neon:
+    cmp r2, #128
+    blo memcpy
+    push {r0, lr}
+1:
+    pld [r1, #192]
+    vld1.8 {d0-d3}, [r1]!
+    vld1.8 {d4-d7}, [r1]!
+    sub r2, r2, #64
+    vst1.8 {d0-d3}, [r0]!
+    vst1.8 {d4-d7}, [r0]!
+    cmp r2, #64
+    bhs 1b
+    bl memcpy                   // Tail
+    pop {r0, pc}
+
+// ARM run-time ABI helpers (RTABI 4.3.4); note memset's argument order
+.global __aeabi_memcpy
+.global __aeabi_memcpy4
+.global __aeabi_memcpy8
+__aeabi_memcpy:
+__aeabi_memcpy4:
+__aeabi_memcpy8:
+    b memcpy
+
+.global __aeabi_memmove
+.global __aeabi_memmove4
+.global __aeabi_memmove8
+__aeabi_memmove:
+__aeabi_memmove4:
+__aeabi_memmove8:
+    b memmove
+
+.global __aeabi_memset
+.global __aeabi_memset4
+.global __aeabi_memset8
+__aeabi_memset:
+__aeabi_memset4:
+__aeabi_memset8:
+    mov r3, r1
+    mov r1, r2
+    mov r2, r3
+    b memset
+
+.global __aeabi_memclr
+.global __aeabi_memclr4
+.global __aeabi_memclr8
+__aeabi_memclr:
+__aeabi_memclr4:
+__aeabi_memclr8:
+    mov r2, r1
+    mov r1, #0
+    b memset
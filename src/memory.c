@@ -0,0 +1,175 @@
+#include "memory.h"
+#include "uart.h"
+
+extern uint32_t __heap_end;
+
+static arena_t boot_arena;
+static arena_t frame_arena;
+
+// Everything registered, for memory_print_stats()
+static arena_t* arenas = 0;
+static pool_t* pools = 0;
+
+void arena_init(arena_t* arena, const char* name, void* base, uint32_t size) {
+    arena->name = name;
+    arena->base = base;
+    arena->size = size;
+    arena->used = 0;
+    arena->high_water = 0;
+    arena->failures = 0;
+    
+    arena->next = arenas;
+    arenas = arena;
+}
+
+// Bump allocation; 'align' must be a power of two. Returns 0 when full.
+void* arena_alloc(arena_t* arena, uint32_t size, uint32_t align) {
+    uint32_t address = (uint32_t)arena->base + arena->used;
+    uint32_t padding = (align - (address & (align - 1))) & (align - 1);
+    
+    if (size > arena->size - arena->used || padding > arena->size - arena->used - size) {
+        arena->failures++;
+        return 0;
+    }
+    
+    arena->used += padding + size;
+    if (arena->used > arena->high_water) {
+        arena->high_water = arena->used;
+    }
+    return (void*)(address + padding);
+}
+
+void arena_reset(arena_t* arena) {
+    arena->used = 0;
+}
+
+// Scoped scratch: everything allocated after arena_mark() is dropped by
+// arena_release() with that mark
+uint32_t arena_mark(const arena_t* arena) {
+    return arena->used;
+}
+
+void arena_release(arena_t* arena, uint32_t mark) {
+    if (mark <= arena->used) {
+        arena->used = mark;
+    }
+}
+
+// Carve 'count' objects of 'object_size' bytes from 'backing' and thread
+// them onto the free list. Returns 0 on success, -1 if the arena is full.
+int pool_init(pool_t* pool, const char* name, arena_t* backing, uint32_t object_size, uint32_t count) {
+    // Every object must be able to hold the free-list link
+    if (object_size < sizeof(void*)) {
+        object_size = sizeof(void*);
+    }
+    object_size = (object_size + MEMORY_DEFAULT_ALIGN - 1) & ~(MEMORY_DEFAULT_ALIGN - 1);
+    
+    uint8_t* storage = arena_alloc(backing, object_size * count, MEMORY_DEFAULT_ALIGN);
+    if (storage == 0) {
+        return -1;
+    }
+    
+    pool->name = name;
+    pool->object_size = object_size;
+    pool->capacity = count;
+    pool->in_use = 0;
+    pool->high_water = 0;
+    pool->failures = 0;
+    
+    pool->free_list = 0;
+    for (uint32_t i = count; i > 0; i--) {
+        void** object = (void**)(storage + (i - 1) * object_size);
+        *object = pool->free_list;
+        pool->free_list = object;
+    }
+    
+    pool->next = pools;
+    pools = pool;
+    return 0;
+}
+
+void* pool_alloc(pool_t* pool) {
+    void** object = pool->free_list;
+    if (object == 0) {
+        pool->failures++;
+        return 0;
+    }
+    
+    pool->free_list = *object;
+    pool->in_use++;
+    if (pool->in_use > pool->high_water) {
+        pool->high_water = pool->in_use;
+    }
+    return object;
+}
+
+void pool_free(pool_t* pool, void* object) {
+    if (object == 0) return;
+    
+    *(void**)object = pool->free_list;
+    pool->free_list = object;
+    pool->in_use--;
+}
+
+// Split the heap: the frame arena at the top, the boot arena below it
+void memory_init(void) {
+    uint32_t start = ((uint32_t)&__heap_start + 15) & ~15;
+    uint32_t end = (uint32_t)&__heap_end & ~15;
+    uint32_t frame_base = end - MEMORY_FRAME_ARENA_SIZE;
+    
+    arena_init(&frame_arena, "frame", (void*)frame_base, MEMORY_FRAME_ARENA_SIZE);
+    arena_init(&boot_arena, "boot", (void*)start, frame_base - start);
+}
+
+arena_t* memory_boot_arena(void) {
+    return &boot_arena;
+}
+
+arena_t* memory_frame_arena(void) {
+    return &frame_arena;
+}
+
+void* boot_alloc(uint32_t size) {
+    return arena_alloc(&boot_arena, size, MEMORY_DEFAULT_ALIGN);
+}
+
+// Valid until the next memory_frame_reset(); main loop only
+void* frame_alloc(uint32_t size) {
+    return arena_alloc(&frame_arena, size, MEMORY_DEFAULT_ALIGN);
+}
+
+void memory_frame_reset(void) {
+    arena_reset(&frame_arena);
+}
+
+void memory_print_stats(void) {
+    for (arena_t* arena = arenas; arena; arena = arena->next) {
+        uart_puts("  arena ");
+        uart_puts(arena->name);
+        uart_puts(": used=");
+        uart_dec(arena->used);
+        uart_puts(" high=");
+        uart_dec(arena->high_water);
+        uart_puts(" size=");
+        uart_dec(arena->size);
+        uart_puts(" failed=");
+        uart_dec(arena->failures);
+        uart_puts("\n");
+    }
+    
+    for (pool_t* pool = pools; pool; pool = pool->next) {
+        uart_puts("  pool ");
+        uart_puts(pool->name);
+        uart_puts(": in use=");
+        uart_dec(pool->in_use);
+        uart_puts(" high=");
+        uart_dec(pool->high_water);
+        uart_puts(" capacity=");
+        uart_dec(pool->capacity);
+        uart_puts(" x ");
+        uart_dec(pool->object_size);
+        uart_puts("B failed=");
+        uart_dec(pool->failures);
+        uart_puts("\n");
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include "kernel.h"
+
+// Memory between __heap_start and __heap_end is handed out by two arenas;
+// there is no general-purpose malloc/free.
+//   boot arena  - allocations that live until reset (layers, caches, levels)
+//   frame arena - scratch, reset at the start of every main-loop frame
+// Fixed-size object pools carve their storage from an arena and then
+// allocate and free in O(1) through an intrusive free list.
+
+#define MEMORY_FRAME_ARENA_SIZE     (64 * 1024)
+#define MEMORY_DEFAULT_ALIGN        8
+
+typedef struct arena {
+    const char* name;
+    uint8_t* base;
+    uint32_t size;
+    uint32_t used;
+    uint32_t high_water;
+    uint32_t failures;      // Allocations refused for lack of space
+    struct arena* next;
+} arena_t;
+
+typedef struct pool {
+    const char* name;
+    void* free_list;
+    uint32_t object_size;
+    uint32_t capacity;
+    uint32_t in_use;
+    uint32_t high_water;
+    uint32_t failures;
+    struct pool* next;
+} pool_t;
+
+// Function declarations
+void memory_init(void);
+arena_t* memory_boot_arena(void);
+arena_t* memory_frame_arena(void);
+void* boot_alloc(uint32_t size);
+void* frame_alloc(uint32_t size);
+void memory_frame_reset(void);
+void memory_print_stats(void);
+
+void arena_init(arena_t* arena, const char* name, void* base, uint32_t size);
+void* arena_alloc(arena_t* arena, uint32_t size, uint32_t align);
+void arena_reset(arena_t* arena);
+uint32_t arena_mark(const arena_t* arena);
+void arena_release(arena_t* arena, uint32_t mark);
+
+int pool_init(pool_t* pool, const char* name, arena_t* backing, uint32_t object_size, uint32_t count);
+void* pool_alloc(pool_t* pool);
+void pool_free(pool_t* pool, void* object);
+
+#endif
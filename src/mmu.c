@@ -0,0 +1,172 @@
+#include "mmu.h"
+#include "mailbox.h"
+
+// SCTLR bits
+#define SCTLR_M         (1 << 0)    // MMU enable
+#define SCTLR_C         (1 << 2)    // Data cache enable
+#define SCTLR_Z         (1 << 11)   // Branch prediction enable
+#define SCTLR_I         (1 << 12)   // Instruction cache enable
+
+#define ACTLR_SMP       (1 << 6)    // Take part in coherency; needed for the caches
+
+#define DACR_ALL_CLIENT 0x55555555
+
+// ARM-local peripherals (core timers, mailboxes) above the SoC peripherals
+#define LOCAL_PERIPHERAL_BASE   0x40000000
+
+// One section descriptor per MB of the 4GB address space
+static uint32_t page_table[4096] __attribute__((aligned(16384)));
+static int mmu_enabled = 0;
+static uint32_t cached_end = 0;
+
+// Invalidate every data/unified cache level by set/way (caches disabled)
+static void dcache_invalidate_all(void) {
+    uint32_t clidr;
+    __asm__ volatile ("mrc p15, 1, %0, c0, c0, 1" : "=r"(clidr));
+    
+    for (uint32_t level = 0; level < 7; level++) {
+        uint32_t type = (clidr >> (level * 3)) & 7;
+        if (type == 0) break;           // No more caches
+        if (type < 2) continue;         // Instruction cache only
+        
+        uint32_t ccsidr;
+        __asm__ volatile ("mcr p15, 2, %0, c0, c0, 0" :: "r"(level << 1));  // CSSELR
+        isb();
+        __asm__ volatile ("mrc p15, 1, %0, c0, c0, 0" : "=r"(ccsidr));
+        
+        uint32_t line_shift = (ccsidr & 7) + 4;
+        uint32_t ways = ((ccsidr >> 3) & 0x3FF) + 1;
+        uint32_t sets = ((ccsidr >> 13) & 0x7FFF) + 1;
+        uint32_t way_shift = ways > 1 ? __builtin_clz(ways - 1) : 0;
+        
+        for (uint32_t way = 0; way < ways; way++) {
+            for (uint32_t set = 0; set < sets; set++) {
+                uint32_t value = (way << way_shift) | (set << line_shift) | (level << 1);
+                __asm__ volatile ("mcr p15, 0, %0, c7, c6, 2" :: "r"(value));   // DCISW
+            }
+        }
+    }
+    dsb();
+}
+
+static void tlb_invalidate_all(void) {
+    __asm__ volatile ("mcr p15, 0, %0, c8, c7, 0" :: "r"(0));   // TLBIALL
+    __asm__ volatile ("mcr p15, 0, %0, c7, c5, 6" :: "r"(0));   // BPIALL
+    dsb();
+    isb();
+}
+
+static void set_sections(uint32_t start, uint32_t end, uint32_t attributes) {
+    for (uint32_t mb = start / MMU_SECTION_SIZE; mb < end / MMU_SECTION_SIZE; mb++) {
+        page_table[mb] = (mb * MMU_SECTION_SIZE) | attributes;
+    }
+}
+
+// ARM RAM size from the firmware; everything above it up to the
+// peripherals belongs to the GPU
+static uint32_t query_arm_memory_end(void) {
+    static mailbox_batch_t batch;
+    
+    mailbox_batch_begin(&batch);
+    uint32_t* memory = mailbox_batch_add(&batch, MAILBOX_TAG_GET_ARM_MEMORY, 8);
+    if (mailbox_call(&batch) != 0 || !mailbox_tag_ok(memory) || memory[1] == 0) {
+        return 0;
+    }
+    return (memory[0] + memory[1]) & ~(MMU_SECTION_SIZE - 1);
+}
+
+// Build the identity map and turn on the MMU, caches and branch prediction.
+// Call once, after the framebuffer has been allocated and before anything
+// relies on cache maintenance.
+void mmu_init(void) {
+    cached_end = query_arm_memory_end();
+    if (cached_end == 0 || cached_end > PERIPHERAL_BASE) {
+        cached_end = PERIPHERAL_BASE - 64 * MMU_SECTION_SIZE; // Default 64MB GPU split
+    }
+    
+    set_sections(0, cached_end, MMU_NORMAL_CACHED);
+    set_sections(cached_end, PERIPHERAL_BASE, MMU_NORMAL_UNCACHED);
+    set_sections(PERIPHERAL_BASE, LOCAL_PERIPHERAL_BASE + MMU_SECTION_SIZE, MMU_DEVICE);
+    // Everything above stays 0: translation fault
+    
+    uint32_t actlr;
+    __asm__ volatile ("mrc p15, 0, %0, c1, c0, 1" : "=r"(actlr));
+    __asm__ volatile ("mcr p15, 0, %0, c1, c0, 1" :: "r"(actlr | ACTLR_SMP));
+    
+    dcache_invalidate_all();
+    __asm__ volatile ("mcr p15, 0, %0, c7, c5, 0" :: "r"(0));   // ICIALLU
+    tlb_invalidate_all();
+    
+    __asm__ volatile ("mcr p15, 0, %0, c3, c0, 0" :: "r"(DACR_ALL_CLIENT));
+    __asm__ volatile ("mcr p15, 0, %0, c2, c0, 2" :: "r"(0));                     // TTBCR: TTBR0 only
+    __asm__ volatile ("mcr p15, 0, %0, c2, c0, 0" :: "r"((uint32_t)page_table)); // TTBR0
+    isb();
+    
+    uint32_t sctlr;
+    __asm__ volatile ("mrc p15, 0, %0, c1, c0, 0" : "=r"(sctlr));
+    sctlr |= SCTLR_M | SCTLR_C | SCTLR_I | SCTLR_Z;
+    __asm__ volatile ("mcr p15, 0, %0, c1, c0, 0" :: "r"(sctlr) : "memory");
+    isb();
+    
+    mmu_enabled = 1;
+}
+
+int mmu_is_enabled(void) {
+    return mmu_enabled;
+}
+
+uint32_t mmu_get_cached_end(void) {
+    return cached_end;
+}
+
+// Change the attributes of the sections covering [start, start + size).
+// Table walks do not look in the data cache, so updated entries are
+// cleaned to memory before the TLB is flushed.
+void mmu_map_region(uint32_t start, uint32_t size, uint32_t attributes) {
+    uint32_t first = start & ~(MMU_SECTION_SIZE - 1);
+    uint32_t end = (start + size + MMU_SECTION_SIZE - 1) & ~(MMU_SECTION_SIZE - 1);
+    
+    // Lines still cached for memory that becomes uncached must reach RAM
+    if (mmu_enabled && !(attributes & MMU_C)) {
+        dcache_clean_invalidate_range((const void*)first, end - first);
+    }
+    
+    set_sections(first, end, attributes);
+    if (mmu_enabled) {
+        dcache_clean_range(&page_table[first / MMU_SECTION_SIZE],
+                           (end - first) / MMU_SECTION_SIZE * sizeof(uint32_t));
+        tlb_invalidate_all();
+    }
+}
+
+void dcache_clean_range(const void* start, uint32_t size) {
+    uint32_t line = (uint32_t)start & ~(CACHE_LINE_SIZE - 1);
+    uint32_t end = (uint32_t)start + size;
+    
+    for (; line < end; line += CACHE_LINE_SIZE) {
+        __asm__ volatile ("mcr p15, 0, %0, c7, c10, 1" :: "r"(line));  // DCCMVAC
+    }
+    dsb();
+}
+
+// Discards any CPU writes to the range: only use on line-aligned buffers
+// the CPU has not written since the last clean
+void dcache_invalidate_range(const void* start, uint32_t size) {
+    uint32_t line = (uint32_t)start & ~(CACHE_LINE_SIZE - 1);
+    uint32_t end = (uint32_t)start + size;
+    
+    for (; line < end; line += CACHE_LINE_SIZE) {
+        __asm__ volatile ("mcr p15, 0, %0, c7, c6, 1" :: "r"(line));   // DCIMVAC
+    }
+    dsb();
+}
+
+void dcache_clean_invalidate_range(const void* start, uint32_t size) {
+    uint32_t line = (uint32_t)start & ~(CACHE_LINE_SIZE - 1);
+    uint32_t end = (uint32_t)start + size;
+    
+    for (; line < end; line += CACHE_LINE_SIZE) {
+        __asm__ volatile ("mcr p15, 0, %0, c7, c14, 1" :: "r"(line));  // DCCIMVAC
+    }
+    dsb();
+}
@@ -0,0 +1,36 @@
+#ifndef MMU_H
+#define MMU_H
+
+#include "kernel.h"
+
+// Identity-mapped MMU with 1MB sections, so the caches can be enabled:
+// ARM RAM is normal write-back cacheable, GPU memory (the framebuffer) is
+// normal non-cacheable so stores merge into bursts, peripherals are device.
+
+#define MMU_SECTION_SIZE    0x100000
+#define CACHE_LINE_SIZE     64          // Cortex-A7 L1 and L2
+
+// Section attributes (short-descriptor format)
+#define MMU_SECTION         0x2
+#define MMU_B               (1 << 2)
+#define MMU_C               (1 << 3)
+#define MMU_XN              (1 << 4)
+#define MMU_AP_RW           (3 << 10)
+#define MMU_TEX(x)          ((x) << 12)
+
+#define MMU_NORMAL_CACHED   (MMU_SECTION | MMU_TEX(1) | MMU_C | MMU_B | MMU_AP_RW)
+#define MMU_NORMAL_UNCACHED (MMU_SECTION | MMU_TEX(1) | MMU_AP_RW)
+#define MMU_DEVICE          (MMU_SECTION | MMU_B | MMU_XN | MMU_AP_RW)
+
+// Function declarations
+void mmu_init(void);
+int mmu_is_enabled(void);
+void mmu_map_region(uint32_t start, uint32_t size, uint32_t attributes);
+uint32_t mmu_get_cached_end(void);
+
+// Data cache maintenance by address, for buffers shared with the GPU
+void dcache_clean_range(const void* start, uint32_t size);
+void dcache_invalidate_range(const void* start, uint32_t size);
+void dcache_clean_invalidate_range(const void* start, uint32_t size);
+
+#endif
@@ -0,0 +1,288 @@
+#include "particles.h"
+#include "framebuffer.h"
+#include "console.h"
+#include "memory.h"
+#include "timer.h"
+#include "uart.h"
+#include "pmu.h"
+
+#define PARTICLE_GRAVITY    ((1 << PARTICLES_SHIFT) / 20)   // Pixels per step^2
+#define PARTICLE_LIFE_MIN   30                              // Steps
+#define PARTICLE_LIFE_RANGE 30
+#define MAX_CATCHUP_STEPS   4
+#define BUDGET_CHECK_MASK   31      // Read the cycle counter every 32 particles
+
+// Pixels of one 2x2 particle saved from under it
+#define SAVED_PIXELS        4
+
+static particle_arrays_t arrays;
+static uint32_t* colors = 0;
+static uint32_t active = 0;
+static uint32_t rng_state = 0;
+static uint32_t last_update = 0;
+static uint32_t pending_us = 0;
+
+// Save-under of the last draw: packed (y << 16 | x) and the 2x2 pixels
+static uint32_t* saved_positions = 0;
+static uint32_t* saved_pixels = 0;
+static uint32_t saved_count = 0;
+static uint32_t* saved_buffer = 0;
+
+// Runtime settings and statistics
+static volatile int enabled = 1;
+static volatile int budget_kcycles = 300;
+static uint32_t last_cycles = 0;
+static uint32_t max_cycles = 0;
+static uint32_t frame_cycles = 0;
+static uint32_t budget_cuts = 0;
+static uint32_t last_drawn = 0;
+
+// Per-byte saturating add of two pixels (SWAR): additive blending
+static inline uint32_t add_saturate(uint32_t a, uint32_t b) {
+    uint32_t sum = (a & 0x7F7F7F7F) + (b & 0x7F7F7F7F);
+    uint32_t carry = ((a & b) | ((a | b) & sum)) & 0x80808080;
+    sum ^= (a ^ b) & 0x80808080;
+    return sum | ((carry >> 7) * 0xFF);
+}
+
+// Dim the color over the last part of a particle's life
+static inline uint32_t fade(uint32_t color, int32_t life) {
+    static const uint32_t masks[4] = { 0xFFFFFFFF, 0x7F7F7F7F, 0x3F3F3F3F, 0x1F1F1F1F };
+    int shift = life > 24 ? 0 : life > 12 ? 1 : life > 6 ? 2 : 3;
+    return (color >> shift) & masks[shift];
+}
+
+static uint32_t random_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static int32_t* alloc_array(void) {
+    int32_t* array = arena_alloc(memory_boot_arena(), PARTICLES_CAPACITY * sizeof(int32_t), 16);
+    if (array) {
+        for (uint32_t i = 0; i < PARTICLES_CAPACITY; i++) {
+            array[i] = 0;
+        }
+    }
+    return array;
+}
+
+// Carve the pool from the boot arena. Returns -1 if it does not fit (the
+// game then runs without particles).
+int particles_init(void) {
+    if (colors) return 0;
+    
+    arrays.x = alloc_array();
+    arrays.y = alloc_array();
+    arrays.vx = alloc_array();
+    arrays.vy = alloc_array();
+    arrays.life = alloc_array();
+    colors = boot_alloc(PARTICLES_CAPACITY * sizeof(uint32_t));
+    saved_positions = boot_alloc(PARTICLES_CAPACITY * sizeof(uint32_t));
+    saved_pixels = boot_alloc(PARTICLES_CAPACITY * SAVED_PIXELS * sizeof(uint32_t));
+    
+    if (!arrays.x || !arrays.y || !arrays.vx || !arrays.vy || !arrays.life ||
+        !colors || !saved_positions || !saved_pixels) {
+        colors = 0;
+        enabled = 0;
+        return -1;
+    }
+    
+    rng_state = timer_get_ticks() | 1;
+    last_update = timer_get_ticks();
+    return 0;
+}
+
+// Emit up to 'count' particles from pixel (x, y) in random directions at up
+// to 'speed' (1/256 pixel per step); excess particles are dropped when the
+// pool is full
+void particles_burst(int x, int y, uint32_t count, uint32_t color, uint32_t speed) {
+    if (!enabled || colors == 0) return;
+    
+    for (uint32_t n = 0; n < count && active < PARTICLES_CAPACITY; n++) {
+        // Uniform in the unit disc: pick in the square, reject the corners
+        int32_t dx, dy;
+        do {
+            dx = (int32_t)(random_next() % 513) - 256;
+            dy = (int32_t)(random_next() % 513) - 256;
+        } while (dx * dx + dy * dy > 256 * 256);
+        
+        uint32_t i = active++;
+        arrays.x[i] = x << PARTICLES_SHIFT;
+        arrays.y[i] = y << PARTICLES_SHIFT;
+        arrays.vx[i] = dx * (int32_t)speed;
+        arrays.vy[i] = dy * (int32_t)speed;
+        arrays.life[i] = PARTICLE_LIFE_MIN + random_next() % PARTICLE_LIFE_RANGE;
+        colors[i] = color;
+    }
+}
+
+// Advance the simulation to 'now' (System Timer) in fixed 60 Hz steps, so
+// particles move the same at every frame rate
+void particles_update(uint32_t now) {
+    uint32_t start = pmu_cycles();
+    
+    pending_us += now - last_update;
+    last_update = now;
+    if (active == 0) {
+        pending_us = 0;
+        return;
+    }
+    
+    uint32_t steps = pending_us / PARTICLES_STEP_US;
+    pending_us -= steps * PARTICLES_STEP_US;
+    if (steps > MAX_CATCHUP_STEPS) {
+        steps = MAX_CATCHUP_STEPS;
+        pending_us = 0;
+    }
+    for (uint32_t i = 0; i < steps; i++) {
+        particles_step_neon(&arrays, active, PARTICLE_GRAVITY);
+    }
+    
+    frame_cycles += pmu_cycles() - start;
+}
+
+// Drop particle i by moving the last one into its slot
+static void kill(uint32_t i) {
+    uint32_t last = --active;
+    arrays.x[i] = arrays.x[last];
+    arrays.y[i] = arrays.y[last];
+    arrays.vx[i] = arrays.vx[last];
+    arrays.vy[i] = arrays.vy[last];
+    arrays.life[i] = arrays.life[last];
+    colors[i] = colors[last];
+    arrays.life[last] = 0;
+}
+
+// Put back the pixels under the previous frame's particles, newest first
+// so overlapping particles unwind correctly. Call before the game draws.
+void particles_erase(void) {
+    uint32_t start = pmu_cycles();
+    framebuffer_t* fb = framebuffer_get();
+    
+    // Nothing to restore into if the shadow was switched since
+    if (saved_buffer == fb->buffer) {
+        for (uint32_t n = saved_count; n-- > 0;) {
+            uint32_t x = saved_positions[n] & 0xFFFF;
+            uint32_t y = saved_positions[n] >> 16;
+            uint32_t* pixel = fb->buffer + y * fb->width + x;
+            const uint32_t* saved = saved_pixels + n * SAVED_PIXELS;
+            
+            pixel[0] = saved[0];
+            pixel[1] = saved[1];
+            pixel[fb->width] = saved[2];
+            pixel[fb->width + 1] = saved[3];
+            framebuffer_mark_dirty(x, y, 2, 2);
+        }
+    }
+    saved_count = 0;
+    
+    frame_cycles += pmu_cycles() - start;
+}
+
+// Blend the live particles into the framebuffer, saving what is under
+// them. Dead and off-screen particles are removed here. Stops early once
+// the frame's cycle budget is used up.
+void particles_draw(void) {
+    uint32_t start = pmu_cycles();
+    uint32_t budget = budget_kcycles * 1000;
+    framebuffer_t* fb = framebuffer_get();
+    uint32_t i = 0;
+    
+    saved_buffer = fb->buffer;
+    while (i < active) {
+        int32_t x = arrays.x[i] >> PARTICLES_SHIFT;
+        int32_t y = arrays.y[i] >> PARTICLES_SHIFT;
+        if (arrays.life[i] == 0 || x < 0 || y < 0 ||
+            x >= (int32_t)fb->width - 1 || y >= (int32_t)fb->height - 1) {
+            kill(i);
+            continue;
+        }
+        if ((i & BUDGET_CHECK_MASK) == 0 && frame_cycles + pmu_cycles() - start > budget) {
+            budget_cuts++;
+            break;
+        }
+        
+        uint32_t* pixel = fb->buffer + y * fb->width + x;
+        uint32_t* saved = saved_pixels + saved_count * SAVED_PIXELS;
+        saved[0] = pixel[0];
+        saved[1] = pixel[1];
+        saved[2] = pixel[fb->width];
+        saved[3] = pixel[fb->width + 1];
+        saved_positions[saved_count++] = (y << 16) | x;
+        
+        uint32_t color = fade(colors[i], arrays.life[i]);
+        pixel[0] = add_saturate(saved[0], color);
+        pixel[1] = add_saturate(saved[1], color);
+        pixel[fb->width] = add_saturate(saved[2], color);
+        pixel[fb->width + 1] = add_saturate(saved[3], color);
+        framebuffer_mark_dirty(x, y, 2, 2);
+        i++;
+    }
+    last_drawn = saved_count;
+    
+    // Erase, update and draw together are what the budget covers
+    last_cycles = frame_cycles + pmu_cycles() - start;
+    if (last_cycles > max_cycles) {
+        max_cycles = last_cycles;
+    }
+    frame_cycles = 0;
+}
+
+// Drop every particle (their pixels are restored by the next erase)
+void particles_clear(void) {
+    while (active) {
+        kill(active - 1);
+    }
+}
+
+uint32_t particles_active(void) {
+    return active;
+}
+
+void particles_set_budget(uint32_t kcycles) {
+    budget_kcycles = kcycles;
+}
+
+static void print_counter(const char* name, uint32_t value) {
+    uart_puts(name);
+    uart_dec(value);
+    uart_puts("\n");
+}
+
+// particles: statistics; particles burst <n>: n particles mid-screen
+static void cmd_particles(int argc, char** argv) {
+    if (argc == 3 && console_arg_is(argv[1], "burst")) {
+        framebuffer_t* fb = framebuffer_get();
+        particles_burst(fb->width / 2, fb->height / 2, console_arg_number(argv[2]),
+                        COLOR_YELLOW, 768);
+        return;
+    }
+    if (argc == 2 && console_arg_is(argv[1], "reset")) {
+        max_cycles = 0;
+        budget_cuts = 0;
+        return;
+    }
+    
+    print_counter("active:       ", active);
+    print_counter("capacity:     ", PARTICLES_CAPACITY);
+    print_counter("drawn:        ", last_drawn);
+    print_counter("last cycles:  ", last_cycles);
+    print_counter("max cycles:   ", max_cycles);
+    print_counter("budget cycles:", budget_kcycles * 1000);
+    print_counter("budget cuts:  ", budget_cuts);
+}
+
+static void enabled_changed(int value) {
+    if (!value) {
+        particles_clear();
+    }
+}
+
+void particles_register_console(void) {
+    console_register_var("fx", &enabled, 0, 1, enabled_changed);
+    console_register_var("fxbudget", &budget_kcycles, 10, 10000, 0);
+    console_register_command("particles", cmd_particles, "[reset | burst <n>] - particle stats");
+}
@@ -0,0 +1,42 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "kernel.h"
+
+// Particle bursts drawn over the game. State is a fixed-capacity pool kept
+// as separate arrays (struct of arrays) in 16.16 fixed point, stepped at
+// 60 Hz by a NEON kernel eight particles at a time (src/particles.s).
+//
+// Particles are 2x2 pixel spans blended additively into the framebuffer.
+// The pixels underneath are saved first and put back by particles_erase()
+// at the start of the next draw, so the game's dirty rendering never sees
+// them. Drawing stops when the per-frame PMU cycle budget is spent.
+
+#define PARTICLES_CAPACITY      4096    // Multiple of 8 (one NEON iteration)
+#define PARTICLES_STEP_US       16667   // Simulation step
+#define PARTICLES_SHIFT         16      // Fixed point: 1.0 pixel
+
+// Arrays handed to the NEON kernel; all PARTICLES_CAPACITY long, 16-byte aligned
+typedef struct {
+    int32_t* x;
+    int32_t* y;
+    int32_t* vx;            // Pixels per step
+    int32_t* vy;
+    int32_t* life;          // Steps left, 0 = dead
+} particle_arrays_t;
+
+// Function declarations
+int particles_init(void);
+void particles_burst(int x, int y, uint32_t count, uint32_t color, uint32_t speed);
+void particles_update(uint32_t now);
+void particles_erase(void);
+void particles_draw(void);
+void particles_clear(void);
+uint32_t particles_active(void);
+void particles_set_budget(uint32_t kcycles);
+void particles_register_console(void);
+
+// NEON kernel (src/particles.s); count is rounded up to a multiple of 8
+void particles_step_neon(const particle_arrays_t* arrays, uint32_t count, int32_t gravity);
+
+#endif
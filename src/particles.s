@@ -0,0 +1,61 @@
+.syntax unified
+.section .text
+.fpu neon
+
+// void particles_step_neon(const particle_arrays_t* arrays, uint32_t count,
+//                          int32_t gravity)
+// One simulation step for particles [0, count) rounded up to 8:
+//     vx -= vx >> 6;  vy -= vy >> 6;  vy += gravity
+//     x += vx;  y += vy;  life = max(life - 1, 0)
+// Two q registers per array, i.e. eight particles per iteration; the arrays
+// are 16-byte aligned. Uses only caller-saved q0-q3 and q8-q15, and like
+// all NEON code here it runs from the main loop only.
+.global particles_step_neon
+particles_step_neon:
+    push {r4-r8, lr}
+    ldm r0, {r3-r7}             // x, y, vx, vy, life
+    adds r1, r1, #7
+    lsrs r1, r1, #3
+    beq 2f
+    vdup.32 q15, r2             // Gravity
+    vmov.i32 q14, #1
+    vmov.i32 q13, #0
+1:
+    // Velocities: drag, then gravity
+    vld1.32 {q0-q1}, [r5:128]
+    vld1.32 {q2-q3}, [r6:128]
+    vshr.s32 q8, q0, #6
+    vshr.s32 q9, q1, #6
+    vshr.s32 q10, q2, #6
+    vshr.s32 q11, q3, #6
+    vsub.i32 q0, q0, q8
+    vsub.i32 q1, q1, q9
+    vsub.i32 q2, q2, q10
+    vsub.i32 q3, q3, q11
+    vadd.i32 q2, q2, q15
+    vadd.i32 q3, q3, q15
+    vst1.32 {q0-q1}, [r5:128]!
+    vst1.32 {q2-q3}, [r6:128]!
+
+    // Positions
+    vld1.32 {q8-q9}, [r3:128]
+    vld1.32 {q10-q11}, [r4:128]
+    vadd.i32 q8, q8, q0
+    vadd.i32 q9, q9, q1
+    vadd.i32 q10, q10, q2
+    vadd.i32 q11, q11, q3
+    vst1.32 {q8-q9}, [r3:128]!
+    vst1.32 {q10-q11}, [r4:128]!
+
+    // Life counts down to zero
+    vld1.32 {q8-q9}, [r7:128]
+    vsub.i32 q8, q8, q14
+    vsub.i32 q9, q9, q14
+    vmax.s32 q8, q8, q13
+    vmax.s32 q9, q9, q13
+    vst1.32 {q8-q9}, [r7:128]!
+
+    subs r1, r1, #1
+    bne 1b
+2:
+    pop {r4-r8, pc}
@@ -0,0 +1,66 @@
+#include "pmu.h"
+
+// PMCR bits
+#define PMCR_E          (1 << 0)    // Enable all counters
+#define PMCR_P          (1 << 1)    // Reset event counters
+#define PMCR_C          (1 << 2)    // Reset cycle counter
+#define PMCR_N_SHIFT    11
+#define PMCR_N_MASK     0x1F
+
+#define PMCNTEN_CYCLES  (1u << 31)
+
+static int counter_count = 0;
+static uint32_t counter_events[PMU_MAX_COUNTERS];
+
+static inline uint32_t read_pmcr(void) {
+    uint32_t value;
+    __asm__ volatile ("mrc p15, 0, %0, c9, c12, 0" : "=r"(value));
+    return value;
+}
+
+static inline void write_pmcr(uint32_t value) {
+    __asm__ volatile ("mcr p15, 0, %0, c9, c12, 0" :: "r"(value));
+}
+
+// Enable the cycle counter and program the default event set:
+// L1D refills, instructions retired, branch mispredicts, L1I refills
+void pmu_init(void) {
+    counter_count = (read_pmcr() >> PMCR_N_SHIFT) & PMCR_N_MASK;
+    if (counter_count > PMU_MAX_COUNTERS) {
+        counter_count = PMU_MAX_COUNTERS;
+    }
+    
+    write_pmcr(PMCR_E | PMCR_P | PMCR_C);
+    
+    pmu_set_event(0, PMU_EVENT_L1D_CACHE_REFILL);
+    pmu_set_event(1, PMU_EVENT_INST_RETIRED);
+    pmu_set_event(2, PMU_EVENT_BR_MIS_PRED);
+    pmu_set_event(3, PMU_EVENT_L1I_CACHE_REFILL);
+    
+    // Enable the cycle counter and every implemented event counter
+    uint32_t enable = PMCNTEN_CYCLES | ((1u << counter_count) - 1);
+    __asm__ volatile ("mcr p15, 0, %0, c9, c12, 1" :: "r"(enable));  // PMCNTENSET
+    isb();
+}
+
+void pmu_set_event(int counter, uint32_t event) {
+    if (counter < 0 || counter >= counter_count) return;
+    
+    __asm__ volatile (
+        "mcr p15, 0, %0, c9, c12, 5\n\t"    // PMSELR
+        "isb\n\t"
+        "mcr p15, 0, %1, c9, c13, 1"        // PMXEVTYPER
+        :
+        : "r"(counter), "r"(event)
+    );
+    counter_events[counter] = event;
+}
+
+uint32_t pmu_get_event(int counter) {
+    if (counter < 0 || counter >= counter_count) return 0;
+    return counter_events[counter];
+}
+
+int pmu_num_counters(void) {
+    return counter_count;
+}
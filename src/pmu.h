@@ -0,0 +1,44 @@
+#ifndef PMU_H
+#define PMU_H
+
+#include "kernel.h"
+
+// Cortex-A7 Performance Monitors: the cycle counter (PMCCNTR) plus up to
+// four configurable event counters
+
+#define PMU_MAX_COUNTERS            4
+
+// Common ARMv7 event numbers
+#define PMU_EVENT_L1I_CACHE_REFILL  0x01
+#define PMU_EVENT_L1D_CACHE_REFILL  0x03
+#define PMU_EVENT_L1D_CACHE         0x04
+#define PMU_EVENT_INST_RETIRED      0x08
+#define PMU_EVENT_BR_MIS_PRED       0x10
+#define PMU_EVENT_CPU_CYCLES        0x11
+#define PMU_EVENT_MEM_ACCESS        0x13
+
+static inline uint32_t pmu_cycles(void) {
+    uint32_t value;
+    __asm__ volatile ("mrc p15, 0, %0, c9, c13, 0" : "=r"(value));
+    return value;
+}
+
+static inline uint32_t pmu_read_counter(int counter) {
+    uint32_t value;
+    __asm__ volatile (
+        "mcr p15, 0, %1, c9, c12, 5\n\t"    // PMSELR: select counter
+        "isb\n\t"
+        "mrc p15, 0, %0, c9, c13, 2"        // PMXEVCNTR
+        : "=r"(value)
+        : "r"(counter)
+    );
+    return value;
+}
+
+// Function declarations
+void pmu_init(void);
+void pmu_set_event(int counter, uint32_t event);
+uint32_t pmu_get_event(int counter);
+int pmu_num_counters(void);
+
+#endif
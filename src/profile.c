@@ -0,0 +1,118 @@
+#include "profile.h"
+#include "uart.h"
+
+static profile_region_t* regions = 0;
+
+// Snapshot the counters. The cycle counter is read last so the cost of
+// reading the event counters is not charged to the region.
+void profile_begin(profile_region_t* region, profile_sample_t* sample) {
+    if (!region->registered) {
+        uint32_t flags = irq_save();
+        region->next = regions;
+        region->min_cycles = 0xFFFFFFFF;
+        regions = region;
+        region->registered = 1;
+        irq_restore(flags);
+    }
+    
+    sample->region = region;
+    for (int i = 0; i < pmu_num_counters(); i++) {
+        sample->events[i] = pmu_read_counter(i);
+    }
+    sample->cycles = pmu_cycles();
+}
+
+void profile_end(profile_sample_t* sample) {
+    uint32_t cycles = pmu_cycles() - sample->cycles;
+    profile_region_t* region = sample->region;
+    
+    for (int i = 0; i < pmu_num_counters(); i++) {
+        region->events[i] += pmu_read_counter(i) - sample->events[i];
+    }
+    
+    region->calls++;
+    region->cycles += cycles;
+    if (cycles < region->min_cycles) {
+        region->min_cycles = cycles;
+    }
+    if (cycles > region->max_cycles) {
+        region->max_cycles = cycles;
+    }
+}
+
+void profile_reset(void) {
+    for (profile_region_t* region = regions; region; region = region->next) {
+        uint32_t flags = irq_save();
+        region->calls = 0;
+        region->min_cycles = 0xFFFFFFFF;
+        region->max_cycles = 0;
+        region->cycles = 0;
+        for (int i = 0; i < PMU_MAX_COUNTERS; i++) {
+            region->events[i] = 0;
+        }
+        irq_restore(flags);
+    }
+}
+
+// 64-by-32 division by shift and subtract; there is no libgcc to provide
+// __aeabi_uldivmod and this only runs when printing a report
+static uint32_t div_u64(uint64_t value, uint32_t divisor) {
+    uint64_t quotient = 0;
+    uint64_t remainder = 0;
+    
+    for (int bit = 63; bit >= 0; bit--) {
+        remainder = (remainder << 1) | ((value >> bit) & 1);
+        if (remainder >= divisor) {
+            remainder -= divisor;
+            quotient |= (uint64_t)1 << bit;
+        }
+    }
+    
+    return quotient > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)quotient;
+}
+
+static const char* event_name(uint32_t event) {
+    switch (event) {
+        case PMU_EVENT_L1I_CACHE_REFILL: return "l1i-miss";
+        case PMU_EVENT_L1D_CACHE_REFILL: return "l1d-miss";
+        case PMU_EVENT_L1D_CACHE:        return "l1d-acc";
+        case PMU_EVENT_INST_RETIRED:     return "instr";
+        case PMU_EVENT_BR_MIS_PRED:      return "br-miss";
+        case PMU_EVENT_CPU_CYCLES:       return "cycles";
+        case PMU_EVENT_MEM_ACCESS:       return "mem-acc";
+        default:                         return "event";
+    }
+}
+
+// One line per region: call count, cycles per call (avg/min/max) and each
+// event counter averaged per call
+void profile_print(void) {
+    if (!regions) {
+        uart_puts("No profile regions recorded\n");
+        return;
+    }
+    
+    for (profile_region_t* region = regions; region; region = region->next) {
+        uart_puts("  ");
+        uart_puts(region->name);
+        uart_puts(": calls=");
+        uart_dec(region->calls);
+        
+        if (region->calls) {
+            uart_puts(" cyc avg=");
+            uart_dec(div_u64(region->cycles, region->calls));
+            uart_puts(" min=");
+            uart_dec(region->min_cycles);
+            uart_puts(" max=");
+            uart_dec(region->max_cycles);
+            
+            for (int i = 0; i < pmu_num_counters(); i++) {
+                uart_puts(" ");
+                uart_puts(event_name(pmu_get_event(i)));
+                uart_puts("=");
+                uart_dec(div_u64(region->events[i], region->calls));
+            }
+        }
+        uart_puts("\n");
+    }
+}
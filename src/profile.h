@@ -0,0 +1,74 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "kernel.h"
+#include "pmu.h"
+
+// Named-region profiling on top of the PMU. Regions are static and
+// register themselves on first use; "prof" on the console prints them.
+//
+//     PROFILE_SCOPE(draw_cell);           // until the end of the block
+//
+//     PROFILE_BEGIN(collision);           // explicit pair, same block
+//     ...
+//     PROFILE_END(collision);
+//
+// Everything compiles out in release builds (or with -DPROFILE_ENABLED=0).
+#ifndef PROFILE_ENABLED
+#ifdef RELEASE
+#define PROFILE_ENABLED 0
+#else
+#define PROFILE_ENABLED 1
+#endif
+#endif
+
+typedef struct profile_region {
+    const char* name;
+    struct profile_region* next;
+    int registered;
+    uint32_t calls;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t cycles;
+    uint64_t events[PMU_MAX_COUNTERS];
+} profile_region_t;
+
+typedef struct {
+    profile_region_t* region;
+    uint32_t cycles;
+    uint32_t events[PMU_MAX_COUNTERS];
+} profile_sample_t;
+
+// Function declarations
+void profile_begin(profile_region_t* region, profile_sample_t* sample);
+void profile_end(profile_sample_t* sample);
+void profile_print(void);
+void profile_reset(void);
+
+#if PROFILE_ENABLED
+
+#define PROFILE_REGION_(id) \
+    static profile_region_t profile_region_##id = { .name = #id }
+
+#define PROFILE_BEGIN(id) \
+    PROFILE_REGION_(id); \
+    profile_sample_t profile_sample_##id; \
+    profile_begin(&profile_region_##id, &profile_sample_##id)
+
+#define PROFILE_END(id) \
+    profile_end(&profile_sample_##id)
+
+#define PROFILE_SCOPE(id) \
+    PROFILE_REGION_(id); \
+    profile_sample_t profile_scope_##id __attribute__((cleanup(profile_end))); \
+    profile_begin(&profile_region_##id, &profile_scope_##id)
+
+#else
+
+#define PROFILE_BEGIN(id)   do { } while (0)
+#define PROFILE_END(id)     do { } while (0)
+#define PROFILE_SCOPE(id)   do { } while (0)
+
+#endif
+
+#endif
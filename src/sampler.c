@@ -0,0 +1,197 @@
+#include "sampler.h"
+#include "interrupts.h"
+#include "telemetry.h"
+#include "timer.h"
+#include "uart.h"
+#include "console.h"
+
+// Entries per TELEMETRY_PROFILE_SAMPLES record
+#define SAMPLER_CHUNK   128
+
+static uint32_t buckets[SAMPLER_BUCKETS];
+static uint32_t text_start = 0;
+static uint32_t bucket_shift = 0;
+static volatile uint32_t samples = 0;
+static volatile uint32_t outside = 0;
+
+static volatile int running = 0;
+static uint32_t period_us = SAMPLER_DEFAULT_US;
+static uint32_t saved_interval_us = 0;
+
+// Tick callback (IRQ context)
+static void sampler_tick(void) {
+    uint32_t offset = interrupts_interrupted_pc() - text_start;
+    uint32_t bucket = offset >> bucket_shift;
+    
+    samples++;
+    if (bucket < SAMPLER_BUCKETS) {
+        buckets[bucket]++;
+    } else {
+        outside++;
+    }
+}
+
+// Pick the finest bucket size (a power of two, at least one instruction)
+// that still covers all of .text
+static void sampler_setup_range(void) {
+    text_start = (uint32_t)&__text_start;
+    uint32_t size = (uint32_t)&__text_end - text_start;
+    
+    bucket_shift = 2;
+    while ((size >> bucket_shift) >= SAMPLER_BUCKETS) {
+        bucket_shift++;
+    }
+}
+
+// Sample on the periodic tick, retuned to 'period' for the duration
+void sampler_start(uint32_t period) {
+    if (running) return;
+    
+    if (text_start == 0) {
+        sampler_setup_range();
+    }
+    period_us = period ? period : SAMPLER_DEFAULT_US;
+    saved_interval_us = timer_get_interval_us();
+    
+    timer_set_tick_callback(sampler_tick);
+    timer_set_interval_us(period_us);
+    timer_tick_acquire();
+    running = 1;
+}
+
+void sampler_stop(void) {
+    if (!running) return;
+    
+    timer_tick_release();
+    timer_set_tick_callback(0);
+    timer_set_interval_us(saved_interval_us);
+    running = 0;
+}
+
+int sampler_is_running(void) {
+    return running;
+}
+
+void sampler_reset(void) {
+    uint32_t flags = irq_save();
+    for (int i = 0; i < SAMPLER_BUCKETS; i++) {
+        buckets[i] = 0;
+    }
+    samples = 0;
+    outside = 0;
+    irq_restore(flags);
+}
+
+// Send the non-empty buckets as telemetry records. Blocking, so the dump
+// is complete even when telemetry streaming is off; sampling is paused
+// while the dump runs so the counts stay consistent.
+int sampler_dump(void) {
+    static sampler_entry_t chunk[SAMPLER_CHUNK];
+    sampler_header_t header;
+    int was_running = running;
+    
+    if (text_start == 0) {
+        sampler_setup_range();
+    }
+    sampler_stop();
+    
+    header.text_start = text_start;
+    header.text_end = (uint32_t)&__text_end;
+    header.bucket_shift = bucket_shift;
+    header.period_us = period_us;
+    header.samples = samples;
+    header.outside = outside;
+    header.entries = 0;
+    for (int i = 0; i < SAMPLER_BUCKETS; i++) {
+        if (buckets[i]) {
+            header.entries++;
+        }
+    }
+    
+    int result = telemetry_send_blocking(TELEMETRY_PROFILE_HEADER, &header, sizeof(header));
+    
+    int used = 0;
+    for (int i = 0; i < SAMPLER_BUCKETS && result == 0; i++) {
+        if (!buckets[i]) continue;
+        
+        chunk[used].address = text_start + ((uint32_t)i << bucket_shift);
+        chunk[used].count = buckets[i];
+        if (++used == SAMPLER_CHUNK) {
+            result = telemetry_send_blocking(TELEMETRY_PROFILE_SAMPLES, chunk, used * sizeof(chunk[0]));
+            used = 0;
+        }
+    }
+    if (used && result == 0) {
+        result = telemetry_send_blocking(TELEMETRY_PROFILE_SAMPLES, chunk, used * sizeof(chunk[0]));
+    }
+    
+    if (was_running) {
+        sampler_start(period_us);
+    }
+    return result;
+}
+
+// Quick look without the host tool: the hottest buckets by address
+void sampler_print_top(int count) {
+    uint32_t floor = 0xFFFFFFFF;
+    
+    uart_puts("samples=");
+    uart_dec(samples);
+    uart_puts(" outside=");
+    uart_dec(outside);
+    uart_puts(" bucket=");
+    uart_dec(1u << bucket_shift);
+    uart_puts(" bytes\n");
+    
+    // Repeatedly pick the largest bucket below the previous pick
+    while (count-- > 0) {
+        int best = -1;
+        for (int i = 0; i < SAMPLER_BUCKETS; i++) {
+            if (buckets[i] && buckets[i] < floor && (best < 0 || buckets[i] > buckets[best])) {
+                best = i;
+            }
+        }
+        if (best < 0) break;
+        
+        floor = buckets[best];
+        for (int i = best; i < SAMPLER_BUCKETS; i++) {
+            if (buckets[i] != floor) continue;
+            uart_puts("  ");
+            uart_hex(text_start + ((uint32_t)i << bucket_shift));
+            uart_puts(" ");
+            uart_dec(buckets[i]);
+            uart_puts("\n");
+        }
+    }
+}
+
+static void cmd_sample(int argc, char** argv) {
+    if (argc >= 2 && console_arg_is(argv[1], "start")) {
+        sampler_start(argc == 3 ? console_arg_number(argv[2]) : 0);
+    } else if (argc == 2 && console_arg_is(argv[1], "stop")) {
+        sampler_stop();
+    } else if (argc == 2 && console_arg_is(argv[1], "reset")) {
+        sampler_reset();
+    } else if (argc == 2 && console_arg_is(argv[1], "dump")) {
+        if (sampler_dump() != 0) {
+            uart_puts("Dump failed\n");
+        }
+        return;
+    } else if (argc == 2 && console_arg_is(argv[1], "top")) {
+        sampler_print_top(10);
+        return;
+    } else if (argc != 1) {
+        uart_puts("Usage: sample [start [us] | stop | reset | dump | top]\n");
+        return;
+    }
+    
+    uart_puts(running ? "sampling every " : "sampler stopped, period ");
+    uart_dec(period_us);
+    uart_puts(" us, ");
+    uart_dec(samples);
+    uart_puts(" samples\n");
+}
+
+void sampler_register_console(void) {
+    console_register_command("sample", cmd_sample, "[start [us]|stop|reset|dump|top] - PC sampling profiler");
+}
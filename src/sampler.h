@@ -0,0 +1,39 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "kernel.h"
+
+// Statistical profiler: the periodic timer tick records the interrupted PC
+// into a histogram over the kernel's .text. Dump it with "sample dump" and
+// symbolize on the host with tools/profile.py against kernel.elf.
+
+#define SAMPLER_BUCKETS         4096
+#define SAMPLER_DEFAULT_US      997     // Prime, so it does not lock to the frame rate
+
+// Dump header (TELEMETRY_PROFILE_HEADER), followed by TELEMETRY_PROFILE_SAMPLES
+// records holding sampler_entry_t pairs for every non-empty bucket
+typedef struct __attribute__((packed)) {
+    uint32_t text_start;
+    uint32_t text_end;
+    uint32_t bucket_shift;  // Bucket n covers text_start + (n << shift)
+    uint32_t period_us;
+    uint32_t samples;       // Total samples, including 'outside'
+    uint32_t outside;       // Samples with a PC outside .text
+    uint32_t entries;       // sampler_entry_t pairs that follow
+} sampler_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t address;       // Start of the bucket
+    uint32_t count;
+} sampler_entry_t;
+
+// Function declarations
+void sampler_start(uint32_t period_us);
+void sampler_stop(void);
+int sampler_is_running(void);
+void sampler_reset(void);
+int sampler_dump(void);
+void sampler_print_top(int count);
+void sampler_register_console(void);
+
+#endif
@@ -4,11 +4,21 @@
 #include "gpio.h"
 #include "uart.h"
 #include "timer.h"
+#include "telemetry.h"
+#include "capture.h"
+#include "log.h"
+#include "console.h"
+#include "profile.h"
+#include "memory.h"
+#include "memops.h"
+#include "level.h"
+#include "particles.h"
+#include "blend.h"
 
 // Game constants
-#define GRID_WIDTH      40
-#define GRID_HEIGHT     30
-#define CELL_SIZE       16
+#define GRID_WIDTH      LEVEL_WIDTH
+#define GRID_HEIGHT     LEVEL_HEIGHT
+#define CELL_SIZE       LEVEL_CELL_SIZE
 #define GRID_OFFSET_X   80
 #define GRID_OFFSET_Y   80
 #define MAX_SNAKE_LENGTH (GRID_WIDTH * GRID_HEIGHT)
@@ -20,50 +30,140 @@ typedef struct {
 
 // Game state
 static snake_game_t game;
-static point_t snake_body[MAX_SNAKE_LENGTH];
+static point_t* snake_body = 0;   // MAX_SNAKE_LENGTH cells from the boot arena
 static point_t food;
 static int last_input_time = 0;
 
+// Food placement and the record needed to replay the game
+static snake_replay_t replay;
+static uint32_t rng_state = 1;
+
+// Render state: what changed since the last snake_draw() for dirty mode
+static volatile int render_mode = SNAKE_RENDER_FULL;
+static int full_redraw_pending = 1;
+static point_t vacated_tail;
+static int tail_vacated = 0;
+static int food_moved = 0;
+static int score_changed = 0;
+
+// Smooth mode: logic steps taken and drawn, the tail cell being vacated
+// during the current step, and how far into that step we are
+static uint32_t steps = 0;
+static uint32_t drawn_steps = 0;
+static point_t anim_tail;
+static int anim_tail_active = 0;
+static uint32_t progress = SNAKE_PROGRESS_ONE;
+
+// Food LED: switched off from snake_draw() instead of sleeping in update
+#define LED_FLASH_US    50000
+static int led_lit = 0;
+static uint32_t led_off_time = 0;
+
+// Particle bursts: count and speed (1/256 pixel per step)
+#define FOOD_PARTICLES      96
+#define FOOD_SPEED          384
+#define DEATH_PARTICLES     600
+#define DEATH_SPEED         640
+
+// Game over and pause panel, centred on the grid and blended over it
+#define PANEL_WIDTH     240
+#define PANEL_HEIGHT    56
+#define PANEL_X         (GRID_OFFSET_X + (GRID_WIDTH * CELL_SIZE - PANEL_WIDTH) / 2)
+#define PANEL_Y         (GRID_OFFSET_Y + (GRID_HEIGHT * CELL_SIZE - PANEL_HEIGHT) / 2)
+#define PANEL_COLOR     0xB0000000      // Black at ~70%
+static int paused = 0;
+static int panel_drawn = 0;
+
 // Input debouncing
 #define INPUT_DEBOUNCE_TIME 100 // ms
 
+static void alloc_body(void) {
+    if (snake_body == 0) {
+        snake_body = boot_alloc(MAX_SNAKE_LENGTH * sizeof(point_t));
+        if (snake_body == 0) {
+            panic("Out of memory for snake body");
+        }
+    }
+}
+
+static uint32_t random_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
 void snake_init(void) {
+    alloc_body();
+    
+    // A fresh seed per game; everything random in the logic comes from it
+    replay.seed = timer_get_ticks() | 1;
+    replay.steps = 0;
+    replay.turn_count = 0;
+    replay.truncated = 0;
+    rng_state = replay.seed;
+    
+    if (level_current() < 0 && level_load(0) != 0) {
+        panic("No valid level linked in");
+    }
+    const level_header_t* level = level_current_header();
+    
     // Initialize game state
     game.score = 0;
     game.game_over = 0;
+    paused = 0;
     game.snake_length = 3;
-    game.direction = DIRECTION_RIGHT;
-    game.next_direction = DIRECTION_RIGHT;
+    game.direction = level->direction;
+    game.next_direction = level->direction;
     
-    // Initialize snake in the middle of the grid
-    snake_body[0].x = GRID_WIDTH / 2;      // Head
-    snake_body[0].y = GRID_HEIGHT / 2;
-    snake_body[1].x = GRID_WIDTH / 2 - 1;  // Body
-    snake_body[1].y = GRID_HEIGHT / 2;
-    snake_body[2].x = GRID_WIDTH / 2 - 2;  // Tail
-    snake_body[2].y = GRID_HEIGHT / 2;
+    // Head on the level's spawn cell, body trailing behind it
+    // (tools/mklevel.py checks those cells are floor)
+    int dx = 0, dy = 0;
+    switch (game.direction) {
+        case DIRECTION_UP:    dy = 1;  break;
+        case DIRECTION_DOWN:  dy = -1; break;
+        case DIRECTION_LEFT:  dx = 1;  break;
+        case DIRECTION_RIGHT: dx = -1; break;
+    }
+    for (int i = 0; i < game.snake_length; i++) {
+        snake_body[i].x = level->spawn_x + dx * i;
+        snake_body[i].y = level->spawn_y + dy * i;
+    }
     
     // Place initial food
     snake_place_food();
     
+    // Restart always repaints the whole screen
+    full_redraw_pending = 1;
+    tail_vacated = 0;
+    anim_tail_active = 0;
+    drawn_steps = steps;
+    
     uart_puts("Snake game initialized!\n");
     uart_puts("Score: 0\n");
 }
 
+static int cell_occupied(int x, int y) {
+    return level_is_wall(x, y) || snake_check_collision_with_body(x, y);
+}
+
 void snake_place_food(void) {
     int attempts = 0;
     do {
-        food.x = timer_get_ticks() % GRID_WIDTH;
-        food.y = (timer_get_ticks() / 7) % GRID_HEIGHT;
+        food.x = random_next() % GRID_WIDTH;
+        food.y = random_next() % GRID_HEIGHT;
         attempts++;
         
-        // Prevent infinite loop
+        // Prevent infinite loop: take the first free cell instead
         if (attempts > 100) {
-            food.x = 0;
-            food.y = 0;
+            for (int i = 0; i < GRID_WIDTH * GRID_HEIGHT; i++) {
+                food.x = i % GRID_WIDTH;
+                food.y = i / GRID_WIDTH;
+                if (!cell_occupied(food.x, food.y)) break;
+            }
             break;
         }
-    } while (snake_check_collision_with_body(food.x, food.y));
+    } while (cell_occupied(food.x, food.y));
 }
 
 int snake_check_collision_with_body(int x, int y) {
@@ -75,8 +175,21 @@ int snake_check_collision_with_body(int x, int y) {
     return 0;
 }
 
+// Burst from the centre of a grid cell
+static void burst_at(point_t cell, uint32_t count, uint32_t color, uint32_t speed) {
+    particles_burst(GRID_OFFSET_X + cell.x * CELL_SIZE + CELL_SIZE / 2,
+                    GRID_OFFSET_Y + cell.y * CELL_SIZE + CELL_SIZE / 2,
+                    count, color, speed);
+}
+
+static void end_game(void) {
+    game.game_over = 1;
+    burst_at(snake_body[0], DEATH_PARTICLES, COLOR_RED, DEATH_SPEED);
+}
+
 void snake_update(void) {
-    if (game.game_over) return;
+    if (game.game_over || paused) return;
+    PROFILE_SCOPE(snake_update);
     
     // Handle input (GPIO buttons)
     uint32_t current_time = timer_get_system_timer() * 10; // Convert to ms
@@ -99,13 +212,24 @@ void snake_update(void) {
         }
     }
     
-    // Update direction
+    // Update direction, keeping turns for the replay
+    if (game.next_direction != game.direction) {
+        if (replay.turn_count < SNAKE_REPLAY_MAX_TURNS) {
+            replay.turns[replay.turn_count++] = (replay.steps << 2) | game.next_direction;
+        } else {
+            replay.truncated++;
+        }
+    }
     game.direction = game.next_direction;
     
+    // Remember the tail cell so dirty rendering can erase it
+    vacated_tail = snake_body[game.snake_length - 1];
+    tail_vacated = 1;
+    
     // Move snake body (start from tail)
-    for (int i = game.snake_length - 1; i > 0; i--) {
-        snake_body[i] = snake_body[i - 1];
-    }
+    memmove(&snake_body[1], &snake_body[0], (game.snake_length - 1) * sizeof(snake_body[0]));
+    steps++;
+    replay.steps++;
     
     // Move head
     switch (game.direction) {
@@ -123,19 +247,30 @@ void snake_update(void) {
             break;
     }
     
-    // Check wall collision
+    // Leaving the grid wraps around on levels that allow it
+    if (level_wraps()) {
+        snake_body[0].x = (snake_body[0].x + GRID_WIDTH) % GRID_WIDTH;
+        snake_body[0].y = (snake_body[0].y + GRID_HEIGHT) % GRID_HEIGHT;
+    }
+    
+    // Check wall collision (the edge of the grid or an obstacle)
     if (snake_body[0].x < 0 || snake_body[0].x >= GRID_WIDTH ||
         snake_body[0].y < 0 || snake_body[0].y >= GRID_HEIGHT) {
-        game.game_over = 1;
-        uart_puts("Game Over! Hit wall.\n");
+        end_game();
+        LOG_INFO("Game Over! Hit wall. Score: %u", game.score);
+        return;
+    }
+    if (level_is_wall(snake_body[0].x, snake_body[0].y)) {
+        end_game();
+        LOG_INFO("Game Over! Hit obstacle. Score: %u", game.score);
         return;
     }
     
     // Check self collision
     for (int i = 1; i < game.snake_length; i++) {
         if (snake_body[0].x == snake_body[i].x && snake_body[0].y == snake_body[i].y) {
-            game.game_over = 1;
-            uart_puts("Game Over! Hit self.\n");
+            end_game();
+            LOG_INFO("Game Over! Hit self. Score: %u", game.score);
             return;
         }
     }
@@ -145,51 +280,67 @@ void snake_update(void) {
         game.score += 10;
         game.snake_length++;
         
-        uart_puts("Food eaten! Score: ");
-        uart_dec(game.score);
-        uart_puts("\n");
+        // The new segment occupies the cell the tail just left
+        snake_body[game.snake_length - 1] = vacated_tail;
+        tail_vacated = 0;
+        score_changed = 1;
+        
+        LOG_INFO("Food eaten! Score: %u", game.score);
+        burst_at(food, FOOD_PARTICLES, COLOR_YELLOW, FOOD_SPEED);
         
         // Place new food
         snake_place_food();
+        food_moved = 1;
         
-        // Flash LED
+        // Flash LED (turned off by snake_draw, never sleep in the update)
         gpio_led_on();
-        timer_sleep(50);
-        gpio_led_off();
+        led_lit = 1;
+        led_off_time = timer_get_ticks() + LED_FLASH_US;
     }
 }
 
-void snake_draw(void) {
-    // Clear screen
-    graphics_clear_screen(COLOR_BLACK);
+// Fill one grid cell (1px gap between cells); cells off the grid are skipped
+static void draw_cell(point_t cell, uint32_t color) {
+    if (cell.x < 0 || cell.x >= GRID_WIDTH || cell.y < 0 || cell.y >= GRID_HEIGHT) return;
+    PROFILE_SCOPE(draw_cell);
     
-    // Draw game area border
-    graphics_draw_rect_outline(
-        GRID_OFFSET_X - 2, 
-        GRID_OFFSET_Y - 2, 
-        GRID_WIDTH * CELL_SIZE + 4, 
-        GRID_HEIGHT * CELL_SIZE + 4, 
-        COLOR_WHITE
-    );
-    
-    // Draw snake
-    for (int i = 0; i < game.snake_length; i++) {
-        uint32_t color = (i == 0) ? COLOR_GREEN : COLOR_DARK_GRAY; // Head vs body
-        
-        int pixel_x = GRID_OFFSET_X + snake_body[i].x * CELL_SIZE;
-        int pixel_y = GRID_OFFSET_Y + snake_body[i].y * CELL_SIZE;
-        
-        graphics_draw_rect(pixel_x, pixel_y, CELL_SIZE - 1, CELL_SIZE - 1, color);
-    }
+    int pixel_x = GRID_OFFSET_X + cell.x * CELL_SIZE;
+    int pixel_y = GRID_OFFSET_Y + cell.y * CELL_SIZE;
+    graphics_draw_rect(pixel_x, pixel_y, CELL_SIZE - 1, CELL_SIZE - 1, color);
+}
+
+// Fill the 'length' pixels of 'cell' on the side facing 'neighbor' with
+// 'color' and the rest black: a snake end partway into or out of a cell
+static void draw_partial_cell(point_t cell, point_t neighbor, int length, uint32_t color) {
+    if (cell.x < 0 || cell.x >= GRID_WIDTH || cell.y < 0 || cell.y >= GRID_HEIGHT) return;
     
-    // Draw food
-    int food_pixel_x = GRID_OFFSET_X + food.x * CELL_SIZE;
-    int food_pixel_y = GRID_OFFSET_Y + food.y * CELL_SIZE;
-    graphics_draw_rect(food_pixel_x, food_pixel_y, CELL_SIZE - 1, CELL_SIZE - 1, COLOR_RED);
+    int x = GRID_OFFSET_X + cell.x * CELL_SIZE;
+    int y = GRID_OFFSET_Y + cell.y * CELL_SIZE;
+    int size = CELL_SIZE - 1;
+    int rest = size - length;
     
-    // Draw score
-    graphics_draw_text("SCORE:", 10, 10, COLOR_WHITE);
+    // Across a wrapped edge the neighbour sits on the far side of the grid
+    if (neighbor.x - cell.x > 1) neighbor.x -= GRID_WIDTH;
+    if (cell.x - neighbor.x > 1) neighbor.x += GRID_WIDTH;
+    if (neighbor.y - cell.y > 1) neighbor.y -= GRID_HEIGHT;
+    if (cell.y - neighbor.y > 1) neighbor.y += GRID_HEIGHT;
     
+    if (neighbor.x < cell.x) {
+        graphics_draw_rect(x, y, length, size, color);
+        graphics_draw_rect(x + length, y, rest, size, COLOR_BLACK);
+    } else if (neighbor.x > cell.x) {
+        graphics_draw_rect(x, y, rest, size, COLOR_BLACK);
+        graphics_draw_rect(x + rest, y, length, size, color);
+    } else if (neighbor.y < cell.y) {
+        graphics_draw_rect(x, y, size, length, color);
+        graphics_draw_rect(x, y + length, size, rest, COLOR_BLACK);
+    } else {
+        graphics_draw_rect(x, y, size, rest, COLOR_BLACK);
+        graphics_draw_rect(x, y + rest, size, length, color);
+    }
+}
+
+static void draw_score(void) {
     // Convert score to string and display
     char score_str[16];
     int score_val = game.score;
@@ -214,20 +365,247 @@ void snake_draw(void) {
     score_str[pos] = '\0';
     
     graphics_draw_text(score_str, 70, 10, COLOR_YELLOW);
+}
+
+static void draw_panel_text(const char* text, int y, uint32_t color) {
+    int length = 0;
+    while (text[length]) {
+        length++;
+    }
+    graphics_draw_text(text, PANEL_X + (PANEL_WIDTH - length * 8) / 2, y, color);
+}
+
+// Dim the board under a framed message. Blending compounds, so this is
+// drawn once over a still board (see snake_draw()).
+static void draw_panel(const char* title, uint32_t title_color, const char* hint) {
+    blend_rect(PANEL_X, PANEL_Y, PANEL_WIDTH, PANEL_HEIGHT, PANEL_COLOR);
+    graphics_draw_rect_outline(PANEL_X, PANEL_Y, PANEL_WIDTH, PANEL_HEIGHT, COLOR_GRAY);
+    draw_panel_text(title, PANEL_Y + 16, title_color);
+    draw_panel_text(hint, PANEL_Y + 32, COLOR_WHITE);
+}
+
+// Repaint everything
+static void draw_full(void) {
+    // Clear screen
+    graphics_clear_screen(COLOR_BLACK);
+    
+    // Draw game area border
+    graphics_draw_rect_outline(
+        GRID_OFFSET_X - 2, 
+        GRID_OFFSET_Y - 2, 
+        GRID_WIDTH * CELL_SIZE + 4, 
+        GRID_HEIGHT * CELL_SIZE + 4, 
+        COLOR_WHITE
+    );
+    
+    // Walls of the current level
+    level_draw_background(GRID_OFFSET_X, GRID_OFFSET_Y);
+    
+    // Draw snake
+    for (int i = 0; i < game.snake_length; i++) {
+        uint32_t color = (i == 0) ? COLOR_GREEN : COLOR_DARK_GRAY; // Head vs body
+        draw_cell(snake_body[i], color);
+    }
+    
+    // Draw food
+    draw_cell(food, COLOR_RED);
+    
+    // Draw score
+    graphics_draw_text("SCORE:", 10, 10, COLOR_WHITE);
+    draw_score();
     
     // Draw controls info
     graphics_draw_text("GPIO: 2=UP 3=DOWN 4=LEFT 17=RIGHT", 10, 30, COLOR_CYAN);
     graphics_draw_text("UART: W=UP S=DOWN A=LEFT D=RIGHT", 10, 50, COLOR_CYAN);
+}
+
+// Repaint only the cells and text that changed since the last draw
+static void draw_dirty(void) {
+    if (tail_vacated) {
+        draw_cell(vacated_tail, COLOR_BLACK);
+    }
+    if (game.snake_length > 1) {
+        draw_cell(snake_body[1], COLOR_DARK_GRAY);
+    }
+    draw_cell(snake_body[0], COLOR_GREEN);
+    
+    if (food_moved) {
+        draw_cell(food, COLOR_RED);
+    }
+    if (score_changed) {
+        graphics_draw_rect(70, 10, 8 * 10, 8, COLOR_BLACK);
+        draw_score();
+    }
+}
+
+// Head and tail of the smooth mode: the head slides in from the previous
+// head cell, the vacated tail cell drains towards the new tail. When the
+// head moved into the cell the tail just left (chasing its own tail), that
+// cell belongs to the head and there is nothing to drain.
+static void draw_moving_ends(void) {
+    uint32_t p = game.game_over ? SNAKE_PROGRESS_ONE : progress;
+    int length = (p * (CELL_SIZE - 1)) >> SNAKE_PROGRESS_SHIFT;
+    
+    if (game.snake_length > 1) {
+        draw_cell(snake_body[1], COLOR_DARK_GRAY);
+        draw_partial_cell(snake_body[0], snake_body[1], length, COLOR_GREEN);
+    } else {
+        draw_cell(snake_body[0], COLOR_GREEN);
+    }
+    if (anim_tail_active &&
+        (anim_tail.x != snake_body[0].x || anim_tail.y != snake_body[0].y)) {
+        draw_partial_cell(anim_tail, snake_body[game.snake_length - 1],
+                          CELL_SIZE - 1 - length, COLOR_DARK_GRAY);
+    }
+}
+
+// Smooth mode runs every display frame, usually several per logic step.
+// Only the moving ends are redrawn; at a step boundary the tail cell that
+// finished draining is cleared. Missing a whole step (a slow frame) would
+// leave a cell nobody erases, so that falls back to a full repaint.
+static void draw_smooth(void) {
+    uint32_t new_steps = steps - drawn_steps;
+    drawn_steps = steps;
+    if (new_steps > 1) {
+        full_redraw_pending = 1;
+    }
+    
+    if (full_redraw_pending) {
+        draw_full();
+        full_redraw_pending = 0;
+    } else {
+        if (new_steps && anim_tail_active) {
+            draw_cell(anim_tail, COLOR_BLACK);
+        }
+        if (food_moved) {
+            draw_cell(food, COLOR_RED);
+        }
+        if (score_changed) {
+            graphics_draw_rect(70, 10, 8 * 10, 8, COLOR_BLACK);
+            draw_score();
+        }
+    }
+    
+    if (new_steps) {
+        anim_tail = vacated_tail;
+        anim_tail_active = tail_vacated;
+    }
+    draw_moving_ends();
+}
+
+void snake_draw(void) {
+    PROFILE_SCOPE(snake_draw);
+    
+    if (led_lit && (int32_t)(timer_get_ticks() - led_off_time) >= 0) {
+        gpio_led_off();
+        led_lit = 0;
+    }
+    
+    // Nothing moves under a panel, and repainting the cells under it would
+    // punch through; only a full repaint (restart, resume) draws again
+    if (panel_drawn && render_mode != SNAKE_RENDER_FULL && !full_redraw_pending) return;
+    
+    if (render_mode == SNAKE_RENDER_SMOOTH) {
+        draw_smooth();
+    } else if (render_mode == SNAKE_RENDER_FULL || full_redraw_pending) {
+        draw_full();
+        full_redraw_pending = 0;
+    } else {
+        draw_dirty();
+    }
     
-    // Draw game over message
+    // Panels go last so the moving ends of the smooth mode stay under them
     if (game.game_over) {
-        graphics_draw_text("GAME OVER!", GRID_OFFSET_X + 100, GRID_OFFSET_Y + 200, COLOR_RED);
-        graphics_draw_text("Reset to play again", GRID_OFFSET_X + 50, GRID_OFFSET_Y + 220, COLOR_WHITE);
+        draw_panel("GAME OVER!", COLOR_RED, "Reset to play again");
+    } else if (paused) {
+        draw_panel("PAUSED", COLOR_YELLOW, "P to resume");
+    }
+    panel_drawn = game.game_over || paused;
+    
+    // Changes have been painted; don't repaint them on the next frame
+    tail_vacated = 0;
+    food_moved = 0;
+    score_changed = 0;
+}
+
+static void render_mode_changed(int value) {
+    (void)value;
+    full_redraw_pending = 1;
+    anim_tail_active = 0;
+    drawn_steps = steps;
+}
+
+// level: list the linked levels; level <n>: switch and restart the game
+static void cmd_level(int argc, char** argv) {
+    if (argc < 2) {
+        for (int i = 0; i < level_count(); i++) {
+            const level_header_t* level = level_get(i);
+            char name[sizeof(level->name) + 1];
+            memcpy(name, level->name, sizeof(level->name));
+            name[sizeof(level->name)] = '\0';
+            
+            uart_puts(i == level_current() ? "* " : "  ");
+            uart_dec(i);
+            uart_puts(": ");
+            uart_puts(name);
+            uart_puts(level->flags & LEVEL_FLAG_WRAP ? " (wrap)\n" : "\n");
+        }
+        return;
+    }
+    
+    if (level_load(console_arg_number(argv[1])) != 0) {
+        uart_puts("No such level\n");
+        return;
+    }
+    snake_init();
+    uart_puts("Level decoded in ");
+    uart_dec(level_get_load_us());
+    uart_puts(" us\n");
+}
+
+// Expose runtime-tunable game settings on the UART console
+void snake_register_console(void) {
+    console_register_var("render", &render_mode, SNAKE_RENDER_FULL, SNAKE_RENDER_SMOOTH,
+                         render_mode_changed);
+    console_register_command("level", cmd_level, "[n] - list levels or switch to level n");
+}
+
+snake_render_mode_t snake_get_render_mode(void) {
+    return render_mode;
+}
+
+// Fraction of the current logic step that has elapsed, 0..SNAKE_PROGRESS_ONE
+void snake_set_progress(uint32_t value) {
+    progress = value > SNAKE_PROGRESS_ONE ? SNAKE_PROGRESS_ONE : value;
+}
+
+// Button presses captured on the FIQ path (GPEDS0 bits). Unlike polling
+// in snake_update(), presses shorter than a game tick are not lost.
+void snake_handle_button_events(uint32_t pins) {
+    if ((pins & (1 << GPIO_BUTTON_UP)) && game.direction != DIRECTION_DOWN) {
+        game.next_direction = DIRECTION_UP;
+    } else if ((pins & (1 << GPIO_BUTTON_DOWN)) && game.direction != DIRECTION_UP) {
+        game.next_direction = DIRECTION_DOWN;
+    } else if ((pins & (1 << GPIO_BUTTON_LEFT)) && game.direction != DIRECTION_RIGHT) {
+        game.next_direction = DIRECTION_LEFT;
+    } else if ((pins & (1 << GPIO_BUTTON_RIGHT)) && game.direction != DIRECTION_LEFT) {
+        game.next_direction = DIRECTION_RIGHT;
     }
 }
 
+const snake_game_t* snake_get_state(void) {
+    return &game;
+}
+
+const snake_replay_t* snake_get_replay(void) {
+    return &replay;
+}
+
 // Override the weak symbol from interrupts.c
 void handle_uart_input(char c) {
+    // Command mode swallows everything until ESC
+    if (console_handle_char(c)) return;
+    
     // Convert to lowercase
     if (c >= 'A' && c <= 'Z') {
         c = c + ('a' - 'A');
@@ -241,40 +619,90 @@ void handle_uart_input(char c) {
                 if (game.direction != DIRECTION_DOWN) {
                     game.next_direction = DIRECTION_UP;
                     last_input_time = current_time;
-                    uart_puts("UP\n");
+                    LOG_DEBUG("UP");
                 }
                 break;
             case 's':
                 if (game.direction != DIRECTION_UP) {
                     game.next_direction = DIRECTION_DOWN;
                     last_input_time = current_time;
-                    uart_puts("DOWN\n");
+                    LOG_DEBUG("DOWN");
                 }
                 break;
             case 'a':
                 if (game.direction != DIRECTION_RIGHT) {
                     game.next_direction = DIRECTION_LEFT;
                     last_input_time = current_time;
-                    uart_puts("LEFT\n");
+                    LOG_DEBUG("LEFT");
                 }
                 break;
             case 'd':
                 if (game.direction != DIRECTION_LEFT) {
                     game.next_direction = DIRECTION_RIGHT;
                     last_input_time = current_time;
-                    uart_puts("RIGHT\n");
+                    LOG_DEBUG("RIGHT");
                 }
                 break;
             case 'r':
                 if (game.game_over) {
                     snake_init(); // Restart game
-                    uart_puts("Game restarted!\n");
+                    LOG_INFO("Game restarted!");
                 }
                 break;
+            case 'p':
+                // Pause; resuming repaints the board from under the panel
+                if (!game.game_over) {
+                    paused = !paused;
+                    if (!paused) {
+                        full_redraw_pending = 1;
+                    }
+                    uart_puts(paused ? "Paused\n" : "Resumed\n");
+                }
+                break;
+            case 't':
+                // Toggle the binary telemetry stream
+                telemetry_set_enabled(!telemetry_is_enabled());
+                uart_puts(telemetry_is_enabled() ? "Telemetry on\n" : "Telemetry off\n");
+                break;
+            case 'c':
+                // Stream the screen (changed tiles only) over UART
+                capture_request(0);
+                break;
             default:
                 // Echo other characters
                 uart_putc(c);
                 break;
         }
     }
-}
\ No newline at end of file
+}
+
+#ifdef BENCH_KERNEL
+// Benchmark setup: a snake of 'length' cells folded back and forth through
+// rows 1 and below, head at the top-left moving right along the empty row 0
+// (GRID_WIDTH - 1 safe steps), food in the last row out of reach
+void snake_bench_layout(int length) {
+    int max_length = (GRID_HEIGHT - 2) * GRID_WIDTH + 1;
+    if (length < 2) length = 2;
+    if (length > max_length) length = max_length;
+    
+    alloc_body();
+    game.score = 0;
+    game.game_over = 0;
+    game.snake_length = length;
+    game.direction = DIRECTION_RIGHT;
+    game.next_direction = DIRECTION_RIGHT;
+    
+    snake_body[0].x = 0;
+    snake_body[0].y = 0;
+    for (int i = 1; i < length; i++) {
+        int row = (i - 1) / GRID_WIDTH;
+        int col = (i - 1) % GRID_WIDTH;
+        snake_body[i].x = (row & 1) ? GRID_WIDTH - 1 - col : col;
+        snake_body[i].y = 1 + row;
+    }
+    
+    food.x = GRID_WIDTH - 1;
+    food.y = GRID_HEIGHT - 1;
+    full_redraw_pending = 1;
+}
+#endif
\ No newline at end of file
@@ -11,6 +11,17 @@ typedef enum {
     DIRECTION_RIGHT = 3
 } direction_t;
 
+// Render modes (selectable at runtime with "set render <n>")
+typedef enum {
+    SNAKE_RENDER_FULL = 0,      // Clear and repaint the whole screen each frame
+    SNAKE_RENDER_DIRTY = 1,     // Repaint only cells that changed
+    SNAKE_RENDER_SMOOTH = 2     // Dirty, plus head/tail sliding between steps
+} snake_render_mode_t;
+
+// Progress through the current logic step for smooth rendering (Q8)
+#define SNAKE_PROGRESS_SHIFT    8
+#define SNAKE_PROGRESS_ONE      (1 << SNAKE_PROGRESS_SHIFT)
+
 // Game state structure
 typedef struct {
     int score;
@@ -20,6 +31,19 @@ typedef struct {
     direction_t next_direction;
 } snake_game_t;
 
+// Replay of the current game: food placement comes from a PRNG seeded in
+// snake_init(), so the seed, the level and the turns are enough to play
+// the game again step by step (tools/replay.py)
+#define SNAKE_REPLAY_MAX_TURNS  1024
+
+typedef struct {
+    uint32_t seed;
+    uint32_t steps;             // Logic steps taken, including the fatal one
+    uint32_t turn_count;
+    uint32_t truncated;         // Turns lost past SNAKE_REPLAY_MAX_TURNS
+    uint32_t turns[SNAKE_REPLAY_MAX_TURNS];     // step << 2 | direction_t
+} snake_replay_t;
+
 // Function declarations
 void snake_init(void);
 void snake_update(void);
@@ -27,5 +51,15 @@ void snake_draw(void);
 void snake_place_food(void);
 int snake_check_collision_with_body(int x, int y);
 void handle_uart_input(char c);
+void snake_handle_button_events(uint32_t pins);
+const snake_game_t* snake_get_state(void);
+const snake_replay_t* snake_get_replay(void);
+void snake_register_console(void);
+snake_render_mode_t snake_get_render_mode(void);
+void snake_set_progress(uint32_t progress);
+
+#ifdef BENCH_KERNEL
+void snake_bench_layout(int length);
+#endif
 
 #endif
\ No newline at end of file
@@ -0,0 +1,348 @@
+#include "storage.h"
+#include "emmc.h"
+#include "bcache.h"
+#include "fat.h"
+#include "console.h"
+#include "uart.h"
+#include "timer.h"
+#include "memory.h"
+
+// Longest record: two numbers, a level name and separators. Replay lines
+// are staged in pieces: a header of three numbers and a level name, one
+// turn (" <step><letter>") per recorded turn, then " +<lost>\n".
+#define DEC_MAX             10
+#define LEVEL_NAME_MAX      16
+#define RECORD_MAX          (2 * DEC_MAX + LEVEL_NAME_MAX + 3)
+#define REPLAY_HEADER_MAX   (3 * DEC_MAX + LEVEL_NAME_MAX + 3)
+#define TURN_MAX            (1 + DEC_MAX + 1)
+#define REPLAY_END_MAX      (2 + DEC_MAX + 1)
+
+// Staging ring size (a power of two) and the largest piece handed to one
+// fat_append(). Appends stop this long before the idle deadline: one can
+// read a few FAT or directory blocks from the card.
+#define SCORES_STAGE_BYTES      1024
+#define REPLAYS_STAGE_BYTES     16384
+#define TELEMETRY_STAGE_BYTES   16384
+#define APPEND_CHUNK        EMMC_BLOCK_SIZE
+#define APPEND_MARGIN_US    2000
+#define SYNC_WINDOW_US      1000000 // "sd sync" appends everything staged
+
+// A file fed from a RAM ring: records are staged whole or dropped
+typedef struct {
+    const char* name;
+    uint32_t capacity;
+    int open;
+    fat_file_t file;
+    uint8_t* ring;
+    uint32_t head;          // Bytes staged (free running)
+    uint32_t tail;          // Bytes appended to the file
+    uint32_t dropped;       // Records that did not fit in the ring
+    uint32_t failed;        // Appends that failed; their bytes are lost
+} stream_t;
+
+typedef enum {
+    STREAM_SCORES = 0,
+    STREAM_REPLAYS,
+    STREAM_TELEMETRY,
+    STREAM_COUNT
+} stream_id_t;
+
+static stream_t streams[STREAM_COUNT] = {
+    { .name = STORAGE_SCORES_FILE, .capacity = SCORES_STAGE_BYTES },
+    { .name = STORAGE_REPLAYS_FILE, .capacity = REPLAYS_STAGE_BYTES },
+    { .name = STORAGE_TELEMETRY_FILE, .capacity = TELEMETRY_STAGE_BYTES },
+};
+static stream_t* const scores = &streams[STREAM_SCORES];
+
+static int ready = 0;
+static uint32_t best_score = 0;
+static uint32_t games = 0;
+
+// Frame stats go to TELEM.BIN every this many frames (0: off)
+static volatile int telemetry_every = 10;
+static uint32_t telemetry_frames = 0;
+
+static uint32_t append_dec(char* out, uint32_t value) {
+    char digits[10];
+    uint32_t count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+// Best score and number of games from the existing file: the first
+// number on each line
+static void scan_scores(void) {
+    uint8_t chunk[EMMC_BLOCK_SIZE];
+    uint32_t offset = 0;
+    uint32_t value = 0;
+    int in_first_field = 1;
+    int read;
+    
+    while ((read = fat_read(&scores->file, offset, chunk, sizeof(chunk))) > 0) {
+        for (int i = 0; i < read; i++) {
+            char c = chunk[i];
+            if (c == '\n') {
+                if (value > best_score) best_score = value;
+                games++;
+                value = 0;
+                in_first_field = 1;
+            } else if (in_first_field && c >= '0' && c <= '9') {
+                value = value * 10 + (c - '0');
+            } else {
+                in_first_field = 0;
+            }
+        }
+        offset += read;
+    }
+}
+
+static int stream_open(stream_t* stream) {
+    stream->ring = boot_alloc(stream->capacity);
+    if (stream->ring == 0) return -1;
+    stream->head = 0;
+    stream->tail = 0;
+    stream->open = fat_open(&stream->file, stream->name, 1) == 0;
+    return stream->open ? 0 : -1;
+}
+
+// Check that a record of up to 'length' bytes fits, counting it as dropped
+// if not. Records are put in pieces after one check, so they stay whole.
+static int stage_room(stream_t* stream, uint32_t length) {
+    if (!ready || !stream->open) return -1;
+    if (stream->capacity - (stream->head - stream->tail) < length) {
+        stream->dropped++;
+        return -1;
+    }
+    return 0;
+}
+
+// Copy into the ring (room checked first). Never touches the card.
+static void stage_put(stream_t* stream, const void* data, uint32_t length) {
+    const uint8_t* in = data;
+    for (uint32_t i = 0; i < length; i++) {
+        stream->ring[(stream->head + i) & (stream->capacity - 1)] = in[i];
+    }
+    stream->head += length;
+}
+
+static void stage(stream_t* stream, const void* data, uint32_t length) {
+    if (stage_room(stream, length) == 0) {
+        stage_put(stream, data, length);
+    }
+}
+
+// Move staged bytes into the file while there is time before 'deadline'
+static void stream_flush(stream_t* stream, uint32_t deadline) {
+    while (stream->head != stream->tail &&
+           (int32_t)(deadline - timer_get_ticks()) > APPEND_MARGIN_US) {
+        uint32_t start = stream->tail & (stream->capacity - 1);
+        uint32_t length = stream->head - stream->tail;
+        if (length > stream->capacity - start) length = stream->capacity - start;
+        if (length > APPEND_CHUNK) length = APPEND_CHUNK;
+        
+        if (fat_append(&stream->file, stream->ring + start, length) != 0) {
+            // The file may hold part of the chunk; don't repeat it
+            stream->failed++;
+            stream->tail = stream->head;
+            return;
+        }
+        stream->tail += length;
+    }
+}
+
+// Bring up the card, the cache and the volume and open the files. Returns
+// -1 (and the game runs without persistence) if any step up to the scores
+// file fails; replays and telemetry are skipped if their files can't open.
+int storage_init(void) {
+    ready = 0;
+    if (emmc_init() != 0) return -1;
+    if (bcache_init() != 0) return -1;
+    
+    // Boot: reading the card here holds up no frame
+    bcache_set_idle(1);
+    int result = -1;
+    if (fat_mount() == 0 && stream_open(scores) == 0) {
+        scan_scores();
+        for (int i = STREAM_SCORES + 1; i < STREAM_COUNT; i++) {
+            stream_open(&streams[i]);
+        }
+        ready = 1;
+        result = 0;
+    }
+    bcache_set_idle(0);
+    return result;
+}
+
+int storage_is_ready(void) {
+    return ready;
+}
+
+// Append the staged records and write back cached blocks until 'deadline'
+// (System Timer, us)
+void storage_idle(uint32_t deadline) {
+    if (!ready) return;
+    
+    bcache_set_idle(1);
+    for (int i = 0; i < STREAM_COUNT; i++) {
+        stream_flush(&streams[i], deadline);
+    }
+    bcache_idle(deadline);
+    bcache_set_idle(0);
+}
+
+// Level names are one field: spaces become underscores
+static uint32_t append_level(char* out, const char* level) {
+    uint32_t count = 0;
+    while (count < LEVEL_NAME_MAX && level[count] != '\0') {
+        out[count] = level[count] == ' ' ? '_' : level[count];
+        count++;
+    }
+    return count;
+}
+
+void storage_record_game(uint32_t score, uint32_t length, const char* level) {
+    if (score > best_score) best_score = score;
+    games++;
+    if (!ready) return;
+    
+    char record[RECORD_MAX];
+    uint32_t pos = append_dec(record, score);
+    record[pos++] = ' ';
+    pos += append_dec(record + pos, length);
+    record[pos++] = ' ';
+    pos += append_level(record + pos, level);
+    record[pos++] = '\n';
+    stage(scores, record, pos);
+}
+
+// One line per game; a replay that ran out of turn slots ends in
+// " +<turns lost>" and can only be played up to its last turn
+void storage_record_replay(const snake_replay_t* replay, uint32_t score, const char* level) {
+    static const char direction_letters[4] = { 'U', 'D', 'L', 'R' };
+    stream_t* stream = &streams[STREAM_REPLAYS];
+    if (stage_room(stream, REPLAY_HEADER_MAX + replay->turn_count * TURN_MAX +
+                           REPLAY_END_MAX) != 0) return;
+    
+    char text[REPLAY_HEADER_MAX];
+    uint32_t pos = append_dec(text, replay->seed);
+    text[pos++] = ' ';
+    pos += append_level(text + pos, level);
+    text[pos++] = ' ';
+    pos += append_dec(text + pos, score);
+    text[pos++] = ' ';
+    pos += append_dec(text + pos, replay->steps);
+    stage_put(stream, text, pos);
+    
+    for (uint32_t i = 0; i < replay->turn_count; i++) {
+        pos = 0;
+        text[pos++] = ' ';
+        pos += append_dec(text + pos, replay->turns[i] >> 2);
+        text[pos++] = direction_letters[replay->turns[i] & 3];
+        stage_put(stream, text, pos);
+    }
+    
+    pos = 0;
+    if (replay->truncated) {
+        text[pos++] = ' ';
+        text[pos++] = '+';
+        pos += append_dec(text + pos, replay->truncated);
+    }
+    text[pos++] = '\n';
+    stage_put(stream, text, pos);
+}
+
+// Every "sdtelem" frames, stage the record framed as on the UART
+void storage_record_telemetry(const telemetry_frame_stats_t* stats) {
+    if (!ready || telemetry_every == 0 || ++telemetry_frames < (uint32_t)telemetry_every) return;
+    telemetry_frames = 0;
+    
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    uint32_t size = telemetry_encode(TELEMETRY_FRAME_STATS, stats, sizeof(*stats), frame);
+    stage(&streams[STREAM_TELEMETRY], frame, size);
+}
+
+uint32_t storage_get_best_score(void) {
+    return best_score;
+}
+
+static void print_counter(const char* name, uint32_t value) {
+    uart_puts(name);
+    uart_dec(value);
+    uart_puts("\n");
+}
+
+// sd: card, volume and cache status; sd sync: write everything back now
+// (waits for the card, outside the idle budget)
+static void cmd_sd(int argc, char** argv) {
+    if (argc == 2 && console_arg_is(argv[1], "sync")) {
+        if (!ready) {
+            uart_puts("No SD card\n");
+            return;
+        }
+        bcache_set_idle(1);
+        for (int i = 0; i < STREAM_COUNT; i++) {
+            stream_flush(&streams[i], timer_get_ticks() + SYNC_WINDOW_US);
+        }
+        uart_puts(bcache_sync() == 0 ? "Synced\n" : "Sync failed\n");
+        bcache_set_idle(0);
+        return;
+    }
+    
+    if (!emmc_is_ready()) {
+        uart_puts("No SD card\n");
+        return;
+    }
+    const bcache_stats_t* stats = bcache_get_stats();
+    print_counter("card MB:       ", emmc_get_block_count() / 2048);
+    print_counter("fat32 mounted: ", fat_is_mounted());
+    print_counter("cluster bytes: ", fat_cluster_bytes());
+    print_counter("dirty blocks:  ", bcache_dirty_count());
+    print_counter("cache hits:    ", stats->hits);
+    print_counter("cache misses:  ", stats->misses);
+    print_counter("block writes:  ", stats->writes);
+    print_counter("frame stalls:  ", stats->stalls);
+    print_counter("errors:        ", stats->errors);
+    
+    // Per file: size, bytes staged, records dropped, failed appends
+    for (int i = 0; i < STREAM_COUNT; i++) {
+        const stream_t* stream = &streams[i];
+        uart_puts(stream->name);
+        if (!stream->open) {
+            uart_puts(": not open\n");
+            continue;
+        }
+        uart_puts(": ");
+        uart_dec(stream->file.size);
+        uart_puts(" bytes, ");
+        uart_dec(stream->head - stream->tail);
+        uart_puts(" staged, ");
+        uart_dec(stream->dropped);
+        uart_puts(" dropped, ");
+        uart_dec(stream->failed);
+        uart_puts(" failed\n");
+    }
+}
+
+static void cmd_scores(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    
+    print_counter("best:  ", best_score);
+    print_counter("games: ", games);
+    if (!ready) {
+        uart_puts("(not persisted: no SD card)\n");
+    }
+}
+
+void storage_register_console(void) {
+    console_register_var("sdtelem", &telemetry_every, 0, 600, 0);
+    console_register_command("sd", cmd_sd, "[sync] - SD card and write-behind cache status");
+    console_register_command("scores", cmd_scores, "best score and games played");
+}
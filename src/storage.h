@@ -0,0 +1,33 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include "kernel.h"
+#include "snake.h"
+#include "telemetry.h"
+
+// Persistent game data on the SD card, appended to files in the root of the
+// FAT32 volume so soak runs leave artifacts:
+//   SCORES.TXT   "<score> <length> <level>" per finished game
+//   REPLAYS.TXT  "<seed> <level> <score> <steps> <turns...>" per finished
+//                game, each turn "<step><U|D|L|R>" (tools/replay.py)
+//   TELEM.BIN    frame stats every "sdtelem" frames, framed exactly as on
+//                the UART (tools/telemetry.py TELEM.BIN --csv)
+// Recording only copies into a RAM staging ring; storage_idle() does the
+// FAT work and the card writes in the main loop's idle time, so nothing
+// here waits for the card during a frame.
+
+#define STORAGE_SCORES_FILE     "SCORES.TXT"
+#define STORAGE_REPLAYS_FILE    "REPLAYS.TXT"
+#define STORAGE_TELEMETRY_FILE  "TELEM.BIN"
+
+// Function declarations
+int storage_init(void);
+int storage_is_ready(void);
+void storage_idle(uint32_t deadline);
+void storage_record_game(uint32_t score, uint32_t length, const char* level);
+void storage_record_replay(const snake_replay_t* replay, uint32_t score, const char* level);
+void storage_record_telemetry(const telemetry_frame_stats_t* stats);
+uint32_t storage_get_best_score(void);
+void storage_register_console(void);
+
+#endif
@@ -0,0 +1,130 @@
+#include "telemetry.h"
+#include "uart.h"
+#include "kernel.h"
+
+static volatile int telemetry_enabled = 0;
+static volatile uint32_t telemetry_dropped = 0;
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), nibble table
+static const uint16_t crc16_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+static uint16_t crc16_update(uint16_t crc, const uint8_t* data, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        crc = (crc << 4) ^ crc16_table[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (crc << 4) ^ crc16_table[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+    return crc;
+}
+
+// COBS encoder state: 'code_pos' is where the current block's length goes
+typedef struct {
+    uint8_t* out;
+    uint32_t pos;
+    uint32_t code_pos;
+    uint8_t code;
+} cobs_encoder_t;
+
+static void cobs_begin(cobs_encoder_t* enc, uint8_t* out) {
+    enc->out = out;
+    enc->code_pos = 0;
+    enc->pos = 1;
+    enc->code = 1;
+}
+
+static void cobs_put(cobs_encoder_t* enc, const uint8_t* data, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        if (data[i] != 0) {
+            enc->out[enc->pos++] = data[i];
+            enc->code++;
+        }
+        
+        if (data[i] == 0 || enc->code == 0xFF) {
+            enc->out[enc->code_pos] = enc->code;
+            enc->code_pos = enc->pos++;
+            enc->code = 1;
+        }
+    }
+}
+
+static uint32_t cobs_end(cobs_encoder_t* enc) {
+    enc->out[enc->code_pos] = enc->code;
+    return enc->pos;
+}
+
+void telemetry_set_enabled(int enabled) {
+    telemetry_enabled = enabled;
+}
+
+int telemetry_is_enabled(void) {
+    return telemetry_enabled;
+}
+
+// Frame one record into 'frame' (up to TELEMETRY_MAX_FRAME bytes) exactly
+// as it goes on the wire; also how records are stored on the SD card.
+// Returns the frame size.
+uint32_t telemetry_encode(uint8_t type, const void* payload, uint32_t length, uint8_t* frame) {
+    cobs_encoder_t enc;
+    
+    uint16_t crc = crc16_update(0xFFFF, &type, 1);
+    crc = crc16_update(crc, payload, length);
+    uint8_t crc_bytes[2] = { crc & 0xFF, crc >> 8 };
+    
+    frame[0] = 0x00; // Leading delimiter separates us from console text
+    cobs_begin(&enc, &frame[1]);
+    cobs_put(&enc, &type, 1);
+    cobs_put(&enc, payload, length);
+    cobs_put(&enc, crc_bytes, 2);
+    uint32_t size = 1 + cobs_end(&enc);
+    frame[size++] = 0x00;
+    return size;
+}
+
+// Frame and queue one record. Uses a large stack buffer, so call it from
+// the main loop rather than from interrupt handlers.
+static int telemetry_emit(uint8_t type, const void* payload, uint32_t length, int wait) {
+    if (length > TELEMETRY_MAX_PAYLOAD) return -1;
+    
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    uint32_t size = telemetry_encode(type, payload, length, frame);
+    
+    // Bulk transfers wait for the TX interrupt to make room. Text queued
+    // from an interrupt between the check and the write can take that room
+    // again, so keep waiting until the whole frame has gone in.
+    if (wait) {
+        while (uart_tx_free() < size || uart_write(frame, size) != 0) {
+            __asm__ volatile ("wfi");
+        }
+        return 0;
+    }
+    
+    // The whole frame goes into the TX ring or none of it does, so text
+    // from interrupt handlers can never land inside a frame
+    if (uart_write(frame, size) != 0) {
+        telemetry_dropped++;
+        return -1;
+    }
+    return 0;
+}
+
+// Periodic records: dropped while telemetry is disabled or the ring is full
+int telemetry_send(uint8_t type, const void* payload, uint32_t length) {
+    if (!telemetry_enabled) return -1;
+    return telemetry_emit(type, payload, length, 0);
+}
+
+// On-demand bulk records (captures, dumps): always sent, waits for space.
+// Needs interrupts enabled so the TX ring keeps draining.
+int telemetry_send_blocking(uint8_t type, const void* payload, uint32_t length) {
+    return telemetry_emit(type, payload, length, 1);
+}
+
+void telemetry_send_frame_stats(const telemetry_frame_stats_t* stats) {
+    telemetry_send(TELEMETRY_FRAME_STATS, stats, sizeof(*stats));
+}
+
+uint32_t telemetry_get_dropped(void) {
+    return telemetry_dropped;
+}
@@ -0,0 +1,56 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "kernel.h"
+
+// Binary telemetry is multiplexed with the text console on the PL011.
+// Each record is sent as: 0x00, COBS(type, payload, crc16), 0x00.
+// Console text never contains 0x00, so the host can split the stream
+// on delimiters (see tools/telemetry.py).
+
+// Largest payload accepted by telemetry_send (excluding type and CRC)
+#define TELEMETRY_MAX_PAYLOAD   1536
+
+// Largest framed record: worst case COBS expansion is one byte per 254,
+// plus two delimiters
+#define TELEMETRY_MAX_RAW       (1 + TELEMETRY_MAX_PAYLOAD + 2)
+#define TELEMETRY_MAX_FRAME     (TELEMETRY_MAX_RAW + TELEMETRY_MAX_RAW / 254 + 3)
+
+// Record types
+typedef enum {
+    TELEMETRY_FRAME_STATS = 0x01,
+    TELEMETRY_CAPTURE_BEGIN = 0x02,
+    TELEMETRY_CAPTURE_TILE = 0x03,
+    TELEMETRY_CAPTURE_END = 0x04,
+    TELEMETRY_LOG = 0x05,
+    TELEMETRY_PROFILE_HEADER = 0x06,
+    TELEMETRY_PROFILE_SAMPLES = 0x07
+} telemetry_type_t;
+
+// Frame status flags
+#define TELEMETRY_FLAG_GAME_OVER    0x0001
+
+// Per-frame statistics (little endian, packed on the wire)
+typedef struct __attribute__((packed)) {
+    uint32_t tick;          // Game loop iteration
+    uint32_t timestamp_us;  // System Timer at end of frame
+    uint32_t update_us;     // Time spent in snake_update()
+    uint32_t draw_us;       // Time spent in snake_draw()
+    uint32_t score;
+    uint16_t length;        // Snake length in cells
+    uint16_t flags;         // TELEMETRY_FLAG_*
+    uint32_t irq_timer;     // Timer interrupts since boot
+    uint32_t irq_uart;      // UART interrupts since boot
+    uint32_t tx_dropped;    // Bytes dropped by the UART TX ring
+} telemetry_frame_stats_t;
+
+// Function declarations
+void telemetry_set_enabled(int enabled);
+int telemetry_is_enabled(void);
+uint32_t telemetry_encode(uint8_t type, const void* payload, uint32_t length, uint8_t* frame);
+int telemetry_send(uint8_t type, const void* payload, uint32_t length);
+int telemetry_send_blocking(uint8_t type, const void* payload, uint32_t length);
+void telemetry_send_frame_stats(const telemetry_frame_stats_t* stats);
+uint32_t telemetry_get_dropped(void);
+
+#endif
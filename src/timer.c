@@ -1,4 +1,5 @@
 #include "timer.h"
+#include "interrupts.h"
 #include "kernel.h"
 
 // System Timer registers
@@ -10,17 +11,38 @@
 #define TIMER_C2    (TIMER_BASE + 0x14)
 #define TIMER_C3    (TIMER_BASE + 0x18)
 
+// TIMER_CS match bits (write 1 to clear)
+#define TIMER_CS_M1 (1 << 1)
+#define TIMER_CS_M3 (1 << 3)
+
 // Timer frequency is 1MHz
 #define TIMER_FREQ  1000000
 
-static volatile uint32_t system_timer_tick = 0;
+// Length of one system timer tick as reported by timer_get_system_timer()
+#define SYSTEM_TICK_US  10000
+
+// Sleeps shorter than this spin instead of arming a compare and sleeping
+#define SLEEP_SPIN_US   20
+
+// Periodic tick on compare channel 1: next deadline and period in us
+static volatile uint32_t tick_compare = 0;
+static volatile uint32_t tick_interval_us = SYSTEM_TICK_US;
+static volatile uint32_t ticks_missed = 0;
+static volatile int tick_armed = 0;
+static volatile timer_callback_t tick_callback = 0;
+
+// Tickless mode: the periodic tick only runs while someone holds it
+static volatile int tickless = 0;
+static volatile int tick_users = 0;
+
+// Compare channel 3 wakes the CPU from wfi at sleep deadlines
+static volatile int sleep_irq_ready = 0;
+static volatile uint32_t sleep_wakeups = 0;
+static volatile uint32_t sleep_deadline = 0;
 
 void timer_init(void) {
     // Clear any pending timer interrupts
     mmio_write(TIMER_CS, 0xF);
-    
-    // Reset our tick counter
-    system_timer_tick = 0;
 }
 
 uint32_t timer_get_ticks(void) {
@@ -28,75 +50,213 @@ uint32_t timer_get_ticks(void) {
 }
 
 uint64_t timer_get_ticks_64(void) {
-    uint32_t hi = mmio_read(TIMER_CHI);
-    uint32_t lo = mmio_read(TIMER_CLO);
+    peripheral_enter();
+    uint32_t hi = mmio_read_relaxed(TIMER_CHI);
+    uint32_t lo = mmio_read_relaxed(TIMER_CLO);
     
     // Check if low counter wrapped during read
-    if (mmio_read(TIMER_CHI) != hi) {
-        hi = mmio_read(TIMER_CHI);
-        lo = mmio_read(TIMER_CLO);
+    if (mmio_read_relaxed(TIMER_CHI) != hi) {
+        hi = mmio_read_relaxed(TIMER_CHI);
+        lo = mmio_read_relaxed(TIMER_CLO);
     }
+    peripheral_exit();
     
     return ((uint64_t)hi << 32) | lo;
 }
 
-void timer_sleep(uint32_t milliseconds) {
-    uint32_t start = timer_get_ticks();
-    uint32_t target = start + (milliseconds * 1000); // Convert ms to microseconds
-    
-    // Handle wrap-around
-    if (target < start) {
-        // Wait for wrap
-        while (timer_get_ticks() >= start) {
-            __asm__("nop");
+// Sleep until the System Timer reaches 'deadline' (wrap-safe). Long waits
+// arm compare channel 3 and halt in wfi; the check and the wfi run with
+// IRQs masked so a deadline that fires in between still wakes us.
+void timer_sleep_until(uint32_t deadline) {
+    while (1) {
+        int32_t remaining = (int32_t)(deadline - timer_get_ticks());
+        if (remaining <= 0) return;
+        
+        if (remaining < SLEEP_SPIN_US || !sleep_irq_ready) {
+            // Spin on the counter alone: no barriers between polls
+            peripheral_enter();
+            while ((int32_t)(deadline - mmio_read_relaxed(TIMER_CLO)) > 0) {
+                __asm__("nop");
+            }
+            peripheral_exit();
+            return;
         }
+        
+        uint32_t flags = irq_save();
+        sleep_deadline = deadline;
+        peripheral_enter();
+        mmio_write_relaxed(TIMER_C3, deadline);
+        remaining = (int32_t)(deadline - mmio_read_relaxed(TIMER_CLO));
+        peripheral_exit();
+        if (remaining > 0) {
+            __asm__ volatile ("wfi");
+        }
+        irq_restore(flags); // Any pending interrupt is taken here
     }
-    
-    // Wait for target
-    while (timer_get_ticks() < target) {
-        __asm__("nop");
-    }
+}
+
+void timer_sleep(uint32_t milliseconds) {
+    timer_sleep_until(timer_get_ticks() + milliseconds * 1000);
 }
 
 void timer_sleep_us(uint32_t microseconds) {
-    uint32_t start = timer_get_ticks();
-    uint32_t target = start + microseconds;
-    
-    // Handle wrap-around
-    if (target < start) {
-        // Wait for wrap
-        while (timer_get_ticks() >= start) {
-            __asm__("nop");
-        }
+    timer_sleep_until(timer_get_ticks() + microseconds);
+}
+
+// Uptime in 10ms ticks, derived from the free-running counter so it stays
+// correct while the periodic tick is stopped
+uint32_t timer_get_system_timer(void) {
+    return timer_get_ticks() / SYSTEM_TICK_US;
+}
+
+static void tick_start(void) {
+    uint32_t flags = irq_save();
+    if (!tick_armed) {
+        peripheral_enter();
+        tick_compare = mmio_read_relaxed(TIMER_CLO) + tick_interval_us;
+        mmio_write_relaxed(TIMER_C1, tick_compare);
+        mmio_write_relaxed(TIMER_CS, TIMER_CS_M1);
+        peripheral_exit();
+        tick_armed = 1;
+        interrupts_enable_irq(IRQ_TIMER_1);
     }
-    
-    // Wait for target
-    while (timer_get_ticks() < target) {
-        __asm__("nop");
+    irq_restore(flags);
+}
+
+static void tick_stop(void) {
+    uint32_t flags = irq_save();
+    if (tick_armed) {
+        interrupts_disable_irq(IRQ_TIMER_1);
+        mmio_write(TIMER_CS, TIMER_CS_M1);
+        tick_armed = 0;
     }
+    irq_restore(flags);
 }
 
-uint32_t timer_get_system_timer(void) {
-    return system_timer_tick;
+// Arm or stop the periodic tick according to the current mode and users
+static void tick_update(void) {
+    if (!sleep_irq_ready) return;
+    
+    if (!tickless || tick_users > 0) {
+        tick_start();
+    } else {
+        tick_stop();
+    }
 }
 
 void timer_set_interval(uint32_t interval_ms) {
-    uint32_t current = timer_get_ticks();
-    uint32_t compare = current + (interval_ms * 1000);
-    
-    // Set timer compare register 1 for periodic interrupt
-    mmio_write(TIMER_C1, compare);
+    timer_set_interval_us(interval_ms * 1000);
+}
+
+void timer_set_interval_us(uint32_t interval_us) {
+    uint32_t flags = irq_save();
+    tick_interval_us = interval_us;
+    if (tick_armed) {
+        peripheral_enter();
+        tick_compare = mmio_read_relaxed(TIMER_CLO) + tick_interval_us;
+        mmio_write_relaxed(TIMER_C1, tick_compare);
+        peripheral_exit();
+    }
+    irq_restore(flags);
+}
+
+uint32_t timer_get_interval_us(void) {
+    return tick_interval_us;
+}
+
+void timer_set_tick_callback(timer_callback_t callback) {
+    tick_callback = callback;
 }
 
 // Called from interrupt handler
 void timer_handle_interrupt(void) {
-    // Clear the interrupt
-    mmio_write(TIMER_CS, 0x2); // Clear timer 1 match
+    // Clear the interrupt; the clear, re-arm and counter read are one
+    // System Timer sequence
+    peripheral_enter();
+    mmio_write_relaxed(TIMER_CS, TIMER_CS_M1); // Clear timer 1 match
+    if (!tick_armed) {
+        peripheral_exit();
+        return;
+    }
+    
+    // How late the compare fired, measured at IRQ entry
+    interrupts_record_latency(IRQ_TIMER_1, interrupts_entry_time() - tick_compare);
+    
+    // Re-arm from the previous deadline, not from "now", so handler latency
+    // does not accumulate into drift. If we fell a whole period or more
+    // behind, skip the missed deadlines (counting them) instead of
+    // programming a compare value that is already in the past.
+    uint32_t next = tick_compare + tick_interval_us;
+    uint32_t current = mmio_read_relaxed(TIMER_CLO);
+    if ((int32_t)(next - current) <= 0) {
+        uint32_t missed = (current - next) / tick_interval_us + 1;
+        ticks_missed += missed;
+        next += missed * tick_interval_us;
+    }
     
-    // Increment our tick counter
-    system_timer_tick++;
+    tick_compare = next;
+    mmio_write_relaxed(TIMER_C1, next);
+    peripheral_exit();
+    
+    if (tick_callback) {
+        tick_callback();
+    }
+}
+
+static void timer_tick_irq(void* ctx) {
+    (void)ctx;
+    timer_handle_interrupt();
+}
+
+// Compare channel 3: a sleep deadline passed; the wakeup is the point
+static void timer_sleep_irq(void* ctx) {
+    (void)ctx;
+    mmio_write(TIMER_CS, TIMER_CS_M3);
+    interrupts_record_latency(IRQ_TIMER_3, interrupts_entry_time() - sleep_deadline);
+    sleep_wakeups++;
+}
+
+// Hook the timer into the interrupt controller. Called by interrupts_init().
+void timer_irq_init(void) {
+    irq_register(IRQ_TIMER_1, timer_tick_irq, 0);
+    irq_register(IRQ_TIMER_3, timer_sleep_irq, 0);
+    interrupts_disable_irq(IRQ_TIMER_1); // Enabled by tick_start()
     
-    // Set next interrupt (every 10ms = 10000 microseconds)
-    uint32_t current = timer_get_ticks();
-    mmio_write(TIMER_C1, current + 10000);
-}
\ No newline at end of file
+    sleep_irq_ready = 1;
+    tick_update();
+}
+
+// Tickless mode stops the periodic tick whenever nobody holds it
+void timer_set_tickless(int enabled) {
+    tickless = enabled;
+    tick_update();
+}
+
+int timer_is_tickless(void) {
+    return tickless;
+}
+
+// Keep the periodic tick running (e.g. for sampling) until released
+void timer_tick_acquire(void) {
+    uint32_t flags = irq_save();
+    tick_users++;
+    irq_restore(flags);
+    tick_update();
+}
+
+void timer_tick_release(void) {
+    uint32_t flags = irq_save();
+    if (tick_users > 0) {
+        tick_users--;
+    }
+    irq_restore(flags);
+    tick_update();
+}
+
+uint32_t timer_get_missed_ticks(void) {
+    return ticks_missed;
+}
+
+uint32_t timer_get_sleep_wakeups(void) {
+    return sleep_wakeups;
+}
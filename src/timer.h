@@ -3,14 +3,28 @@
 
 #include "kernel.h"
 
+// Called from the periodic tick interrupt
+typedef void (*timer_callback_t)(void);
+
 // Function declarations
 void timer_init(void);
 uint32_t timer_get_ticks(void);
 uint64_t timer_get_ticks_64(void);
 void timer_sleep(uint32_t milliseconds);
 void timer_sleep_us(uint32_t microseconds);
+void timer_sleep_until(uint32_t deadline);
 uint32_t timer_get_system_timer(void);
 void timer_set_interval(uint32_t interval_ms);
+void timer_set_interval_us(uint32_t interval_us);
+uint32_t timer_get_interval_us(void);
+void timer_set_tick_callback(timer_callback_t callback);
 void timer_handle_interrupt(void);
+void timer_irq_init(void);
+void timer_set_tickless(int enabled);
+int timer_is_tickless(void);
+void timer_tick_acquire(void);
+void timer_tick_release(void);
+uint32_t timer_get_missed_ticks(void);
+uint32_t timer_get_sleep_wakeups(void);
 
 #endif
\ No newline at end of file
@@ -23,6 +23,7 @@
 #define UART_TDR        (UART_BASE + 0x8C)
 
 // UART_FR bits
+#define UART_FR_BUSY    0x08    // UART busy transmitting
 #define UART_FR_RXFE    0x10    // Receive FIFO empty
 #define UART_FR_TXFF    0x20    // Transmit FIFO full
 #define UART_FR_RXFF    0x40    // Receive FIFO full
@@ -37,11 +38,64 @@
 #define UART_CR_TXE     0x100   // Transmit enable
 #define UART_CR_RXE     0x200   // Receive enable
 
-// UART_IMSC bits
+// UART_IFLS bits
+#define UART_IFLS_TX_1_8    0x00    // TX interrupt when FIFO <= 1/8 full
+#define UART_IFLS_RX_1_8    0x00    // RX interrupt when FIFO >= 1/8 full
+
+// UART_IMSC / UART_MIS / UART_ICR bits
 #define UART_IMSC_RXIM  0x10    // Receive interrupt mask
+#define UART_IMSC_TXIM  0x20    // Transmit interrupt mask
+#define UART_IMSC_RTIM  0x40    // Receive timeout interrupt mask
+
+// Transmit ring buffer (size must be a power of two)
+#define UART_TX_RING_SIZE   4096
+#define UART_TX_RING_MASK   (UART_TX_RING_SIZE - 1)
 
 static volatile int uart_initialized = 0;
 
+// Producers append at tx_head, the TX interrupt drains from tx_tail.
+// Both sides run with IRQs masked, so plain volatile indices are enough.
+static volatile uint8_t tx_ring[UART_TX_RING_SIZE];
+static volatile uint32_t tx_head = 0;
+static volatile uint32_t tx_tail = 0;
+static volatile uint32_t tx_dropped = 0;
+static volatile uint32_t imsc_shadow = 0;
+
+// Queue one byte; caller must have IRQs masked
+static void tx_push(uint8_t c) {
+    uint32_t next = (tx_head + 1) & UART_TX_RING_MASK;
+    
+    if (next == tx_tail) {
+        tx_dropped++; // Ring full - drop rather than block
+        return;
+    }
+    
+    tx_ring[tx_head] = c;
+    tx_head = next;
+}
+
+// Move queued bytes into the hardware FIFO; caller must have IRQs masked
+// and bracket the call with peripheral_enter()/peripheral_exit()
+static void tx_fill(void) {
+    while (tx_tail != tx_head && !(mmio_read_relaxed(UART_FR) & UART_FR_TXFF)) {
+        mmio_write_relaxed(UART_DR, tx_ring[tx_tail]);
+        tx_tail = (tx_tail + 1) & UART_TX_RING_MASK;
+    }
+    
+    // Only keep the TX interrupt armed while there is something left to send
+    uint32_t imsc = imsc_shadow;
+    if (tx_tail != tx_head) {
+        imsc |= UART_IMSC_TXIM;
+    } else {
+        imsc &= ~UART_IMSC_TXIM;
+    }
+    
+    if (imsc != imsc_shadow) {
+        imsc_shadow = imsc;
+        mmio_write_relaxed(UART_IMSC, imsc);
+    }
+}
+
 void uart_init(void) {
     // Disable UART
     mmio_write(UART_CR, 0);
@@ -55,24 +109,31 @@ void uart_init(void) {
     gpio_set_pull(15, GPIO_PULL_NONE);
     
     // Clear pending interrupts
-    mmio_write(UART_ICR, 0x7FF);
+    peripheral_enter();
+    mmio_write_relaxed(UART_ICR, 0x7FF);
     
     // Set baud rate: 115200
     // UART clock = 48MHz on RPi2
     // Divisor = 48000000 / (16 * 115200) = 26.041666...
     // Integer part: 26
     // Fractional part: 0.041666... * 64 = 2.666... ≈ 3
-    mmio_write(UART_IBRD, 26);
-    mmio_write(UART_FBRD, 3);
+    mmio_write_relaxed(UART_IBRD, 26);
+    mmio_write_relaxed(UART_FBRD, 3);
     
     // Set 8N1 (8 bits, no parity, 1 stop bit) and enable FIFO
-    mmio_write(UART_LCRH, UART_LCRH_WLEN8 | UART_LCRH_FEN);
+    mmio_write_relaxed(UART_LCRH, UART_LCRH_WLEN8 | UART_LCRH_FEN);
+    
+    // Interrupt as soon as 2 bytes arrive or the TX FIFO is nearly empty;
+    // the receive timeout catches single keypresses below the RX threshold
+    mmio_write_relaxed(UART_IFLS, UART_IFLS_TX_1_8 | UART_IFLS_RX_1_8);
     
-    // Enable receive interrupts
-    mmio_write(UART_IMSC, UART_IMSC_RXIM);
+    // Enable receive interrupts (TX is armed on demand by tx_fill)
+    imsc_shadow = UART_IMSC_RXIM | UART_IMSC_RTIM;
+    mmio_write_relaxed(UART_IMSC, imsc_shadow);
     
     // Enable UART, TX and RX
-    mmio_write(UART_CR, UART_CR_UARTEN | UART_CR_TXE | UART_CR_RXE);
+    mmio_write_relaxed(UART_CR, UART_CR_UARTEN | UART_CR_TXE | UART_CR_RXE);
+    peripheral_exit();
     
     uart_initialized = 1;
 }
@@ -80,82 +141,153 @@ void uart_init(void) {
 void uart_putc(char c) {
     if (!uart_initialized) return;
     
-    // Wait for transmit FIFO to not be full
-    while (mmio_read(UART_FR) & UART_FR_TXFF) {
-        // Wait
-    }
-    
-    // Write character
-    mmio_write(UART_DR, c);
+    uint32_t flags = irq_save();
+    tx_push(c);
+    peripheral_enter();
+    tx_fill();
+    peripheral_exit();
+    irq_restore(flags);
 }
 
 char uart_getc(void) {
     if (!uart_initialized) return 0;
     
     // Wait for receive FIFO to not be empty
-    while (mmio_read(UART_FR) & UART_FR_RXFE) {
+    peripheral_enter();
+    while (mmio_read_relaxed(UART_FR) & UART_FR_RXFE) {
         // Wait
     }
     
     // Read character
-    return mmio_read(UART_DR) & 0xFF;
+    char c = mmio_read_relaxed(UART_DR) & 0xFF;
+    peripheral_exit();
+    return c;
 }
 
 int uart_getc_nonblocking(void) {
     if (!uart_initialized) return -1;
     
     // Check if receive FIFO is empty
-    if (mmio_read(UART_FR) & UART_FR_RXFE) {
-        return -1; // No character available
+    int c = -1; // No character available
+    peripheral_enter();
+    if (!(mmio_read_relaxed(UART_FR) & UART_FR_RXFE)) {
+        c = mmio_read_relaxed(UART_DR) & 0xFF;
     }
-    
-    // Read character
-    return mmio_read(UART_DR) & 0xFF;
+    peripheral_exit();
+    return c;
 }
 
 void uart_puts(const char* str) {
     if (!uart_initialized) return;
     
+    // Queue the whole string in one critical section so it is not
+    // interleaved with output from interrupt handlers
+    uint32_t flags = irq_save();
     while (*str) {
         if (*str == '\n') {
-            uart_putc('\r'); // Convert LF to CRLF
+            tx_push('\r'); // Convert LF to CRLF
         }
-        uart_putc(*str++);
+        tx_push(*str++);
     }
+    peripheral_enter();
+    tx_fill();
+    peripheral_exit();
+    irq_restore(flags);
 }
 
 void uart_hex(uint32_t value) {
     if (!uart_initialized) return;
     
-    uart_puts("0x");
+    char buffer[11];
+    buffer[0] = '0';
+    buffer[1] = 'x';
     for (int i = 7; i >= 0; i--) {
         uint32_t digit = (value >> (i * 4)) & 0xF;
         if (digit < 10) {
-            uart_putc('0' + digit);
+            buffer[9 - i] = '0' + digit;
         } else {
-            uart_putc('A' + digit - 10);
+            buffer[9 - i] = 'A' + digit - 10;
         }
     }
+    buffer[10] = '\0';
+    
+    uart_puts(buffer);
 }
 
 void uart_dec(uint32_t value) {
     if (!uart_initialized) return;
     
-    if (value == 0) {
-        uart_putc('0');
-        return;
+    char buffer[12];
+    int pos = sizeof(buffer) - 1;
+    buffer[pos] = '\0';
+    
+    // Build digits from the end of the buffer
+    do {
+        buffer[--pos] = '0' + (value % 10);
+        value /= 10;
+    } while (value > 0);
+    
+    uart_puts(&buffer[pos]);
+}
+
+// Queue a binary block atomically: either all of it fits in the TX ring
+// or nothing is queued and the bytes are counted as dropped
+int uart_write(const uint8_t* data, uint32_t length) {
+    if (!uart_initialized) return -1;
+    
+    uint32_t flags = irq_save();
+    uint32_t used = (tx_head - tx_tail) & UART_TX_RING_MASK;
+    
+    if (length > UART_TX_RING_MASK - used) {
+        tx_dropped += length;
+        irq_restore(flags);
+        return -1;
     }
     
-    char buffer[32];
-    int pos = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        tx_push(data[i]);
+    }
+    peripheral_enter();
+    tx_fill();
+    peripheral_exit();
+    irq_restore(flags);
+    return 0;
+}
+
+// Called from the UART interrupt: refill the TX FIFO from the ring
+void uart_handle_tx_interrupt(void) {
+    uint32_t flags = irq_save();
+    peripheral_enter();
+    if (mmio_read_relaxed(UART_MIS) & UART_IMSC_TXIM) {
+        tx_fill();
+        mmio_write_relaxed(UART_ICR, UART_IMSC_TXIM); // Clear TX interrupt
+    }
+    peripheral_exit();
+    irq_restore(flags);
+}
+
+// Synchronously drain everything queued - for panic and fatal paths
+void uart_flush(void) {
+    if (!uart_initialized) return;
     
-    while (value > 0) {
-        buffer[pos++] = '0' + (value % 10);
-        value /= 10;
+    uint32_t flags = irq_save();
+    peripheral_enter();
+    while (tx_tail != tx_head) {
+        tx_fill();
     }
     
-    // Print digits in reverse order
-    for (int i = pos - 1; i >= 0; i--) {
-        uart_putc(buffer[i]);
+    // Wait for the shifter to go idle so the last byte is on the wire
+    while (mmio_read_relaxed(UART_FR) & UART_FR_BUSY) {
+        // Wait
     }
+    peripheral_exit();
+    irq_restore(flags);
+}
+
+uint32_t uart_tx_free(void) {
+    return UART_TX_RING_MASK - ((tx_head - tx_tail) & UART_TX_RING_MASK);
+}
+
+uint32_t uart_get_tx_dropped(void) {
+    return tx_dropped;
 }
\ No newline at end of file
@@ -11,5 +11,10 @@ int uart_getc_nonblocking(void);
 void uart_puts(const char* str);
 void uart_hex(uint32_t value);
 void uart_dec(uint32_t value);
+int uart_write(const uint8_t* data, uint32_t length);
+void uart_flush(void);
+uint32_t uart_tx_free(void);
+void uart_handle_tx_interrupt(void);
+uint32_t uart_get_tx_dropped(void);
 
 #endif
\ No newline at end of file
@@ -1,9 +1,17 @@
 .section .text
 
+// fiq_queue_t layout (keep in sync with src/fiq.h)
+.equ FIQ_QUEUE_HEAD,    0
+.equ FIQ_QUEUE_TAIL,    4
+.equ FIQ_QUEUE_DROPPED, 8
+.equ FIQ_QUEUE_ENTRIES, 16
+.equ FIQ_QUEUE_MASK,    63
+
 .global vectors_start
 .global enable_interrupts
 
-// Exception vector table
+// Exception vector table (VBAR requires 32-byte alignment)
+.balign 32
 vectors_start:
     ldr pc, =reset_handler
     ldr pc, =undefined_handler
@@ -38,7 +46,8 @@ irq_handler:
     // Save context on IRQ stack
     push {r0-r12, lr}
     
-    // Call C IRQ handler
+    // Call C IRQ handler with the interrupted PC (lr_irq is PC + 4)
+    sub r0, lr, #4
     bl handle_irq
     
     // Restore context
@@ -47,8 +56,43 @@ irq_handler:
     // Return from IRQ
     subs pc, lr, #4
 
+// FIQ Handler - no context save. The banked r8-r12 are preloaded by
+// fiq_setup_banked(): r8 = peripheral base, r9 = fiq_queue_t,
+// r12 = source handler. r10, r11 and the unused sp_fiq are scratch.
 fiq_handler:
-    b halt
+    mov pc, r12
+
+// GPIO bank 0 edge events: push GPEDS0 into the queue and clear it
+.global fiq_gpio_handler
+fiq_gpio_handler:
+    dmb                         // Order against an interrupted peripheral access
+    ldr r10, [r8, #0x40]        // GPEDS0 - pins with a detected edge
+    str r10, [r8, #0x40]        // Write 1s back to clear them
+    ldr r11, [r9, #FIQ_QUEUE_HEAD]
+    add sp, r9, #FIQ_QUEUE_ENTRIES
+    str r10, [sp, r11, lsl #2]  // The slot at head is always free
+    add r11, r11, #1
+    and r11, r11, #FIQ_QUEUE_MASK
+    ldr sp, [r9, #FIQ_QUEUE_TAIL]
+    cmp r11, sp
+    strne r11, [r9, #FIQ_QUEUE_HEAD]    // Publish unless the queue is full
+    ldreq sp, [r9, #FIQ_QUEUE_DROPPED]
+    addeq sp, sp, #1
+    streq sp, [r9, #FIQ_QUEUE_DROPPED]
+    dmb
+    subs pc, lr, #4
+
+// void fiq_setup_banked(uint32_t base, fiq_queue_t* queue, void (*handler)(void))
+.global fiq_setup_banked
+fiq_setup_banked:
+    mrs r3, cpsr
+    cpsid if
+    cps #0x11                   // FIQ mode: r8-r12 are banked here
+    mov r8, r0
+    mov r9, r1
+    mov r12, r2
+    msr cpsr_c, r3              // Back to the caller's mode and mask
+    bx lr
 
 // Enable interrupts
 enable_interrupts:
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""Compare two graphics benchmark runs (bench/graphics_bench JSON output).
+
+Exits non-zero if any benchmark got slower than --threshold percent or if
+its output checksum changed (the optimization altered what is drawn).
+
+Usage:
+    make bench-host BENCH_JSON=base.json      # on the baseline commit
+    make bench-host BENCH_JSON=new.json       # with the change
+    tools/bench_compare.py base.json new.json --threshold 5
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return {r["name"]: r for r in json.load(f)["results"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="allowed slowdown in percent (default 5)")
+    parser.add_argument("--ignore-checksum", action="store_true",
+                        help="do not fail on changed output")
+    args = parser.parse_args()
+
+    base = load(args.baseline)
+    cand = load(args.candidate)
+    failures = 0
+
+    print("%-18s %12s %12s %8s  %s" % ("benchmark", "base ns", "new ns", "change", "status"))
+    for name in base:
+        if name not in cand:
+            print("%-18s %12.1f %12s %8s  MISSING" % (name, base[name]["ns_per_call"], "-", "-"))
+            failures += 1
+            continue
+
+        old, new = base[name]["ns_per_call"], cand[name]["ns_per_call"]
+        change = (new - old) * 100.0 / old if old else 0.0
+        status = "ok"
+        if change > args.threshold:
+            status = "SLOWER"
+            failures += 1
+        elif change < -args.threshold:
+            status = "faster"
+        if base[name]["checksum"] != cand[name]["checksum"] and not args.ignore_checksum:
+            status += " OUTPUT CHANGED"
+            failures += 1
+        print("%-18s %12.1f %12.1f %+7.1f%%  %s" % (name, old, new, change, status))
+
+    for name in cand:
+        if name not in base:
+            print("%-18s %12s %12.1f %8s  new" % (name, "-", cand[name]["ns_per_call"], "-"))
+
+    print("PASS" if failures == 0 else "FAIL (%d)" % failures)
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == "__main__":
+    main()
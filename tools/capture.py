@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Rebuild screen captures streamed by the kernel (src/capture.c).
+
+Reads the UART stream (serial device, file or '-'), applies each capture's
+changed tiles to a host-side copy of the screen and writes one PNG per
+capture. With --video the PNG sequence is also assembled with ffmpeg.
+
+Usage:
+    tools/capture.py /dev/ttyUSB0 -o captures/
+    tools/capture.py session.bin -o captures/ --video captures.mp4
+"""
+
+import argparse
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import zlib
+
+import telemetry
+
+TELEMETRY_CAPTURE_BEGIN = 0x02
+TELEMETRY_CAPTURE_TILE = 0x03
+TELEMETRY_CAPTURE_END = 0x04
+
+CAPTURE_BEGIN = struct.Struct("<IHHBB")
+CAPTURE_TILE = struct.Struct("<HHBB")
+CAPTURE_END = struct.Struct("<IHHII")
+
+
+def write_png(path, width, height, rgb):
+    """Write an 8-bit RGB PNG from a flat bytearray (no PIL needed)."""
+    stride = width * 3
+    raw = bytearray()
+    for y in range(height):
+        raw.append(0)  # filter: none
+        raw += rgb[y * stride:(y + 1) * stride]
+
+    def chunk(tag, data):
+        body = tag + data
+        return struct.pack(">I", len(data)) + body + struct.pack(">I", zlib.crc32(body) & 0xFFFFFFFF)
+
+    with open(path, "wb") as f:
+        f.write(b"\x89PNG\r\n\x1a\n")
+        f.write(chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 2, 0, 0, 0)))
+        f.write(chunk(b"IDAT", zlib.compress(bytes(raw), 6)))
+        f.write(chunk(b"IEND", b""))
+
+
+class Screen:
+    def __init__(self):
+        self.width = 0
+        self.height = 0
+        self.rgb = bytearray()
+        self.have_keyframe = False
+
+    def begin(self, payload):
+        frame_id, width, height, _tile, keyframe = CAPTURE_BEGIN.unpack_from(payload)
+        if (width, height) != (self.width, self.height):
+            self.width, self.height = width, height
+            self.rgb = bytearray(width * height * 3)
+            self.have_keyframe = False
+        if keyframe:
+            self.have_keyframe = True
+        return frame_id
+
+    def apply_tile(self, payload):
+        x, y, w, h = CAPTURE_TILE.unpack_from(payload)
+        pos = CAPTURE_TILE.size
+        px = 0
+        total = w * h
+        while px < total and pos + 5 <= len(payload):
+            length = payload[pos] + 1
+            b, g, r = payload[pos + 1], payload[pos + 2], payload[pos + 3]
+            pos += 5
+            for _ in range(min(length, total - px)):
+                offset = ((y + px // w) * self.width + x + px % w) * 3
+                self.rgb[offset:offset + 3] = bytes((r, g, b))
+                px += 1
+        return px == total
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", help="serial device, file, or '-' for stdin")
+    parser.add_argument("-o", "--output", default="captures", help="output directory")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--video", help="also assemble an mp4 with ffmpeg")
+    parser.add_argument("--fps", type=int, default=10)
+    args = parser.parse_args()
+
+    os.makedirs(args.output, exist_ok=True)
+    screen = Screen()
+    written = []
+    current = None
+
+    try:
+        for event in telemetry.read_events(telemetry.open_stream(args.source, args.baud)):
+            if event[0] == "text":
+                sys.stderr.write(event[1].decode("ascii", "replace"))
+                continue
+            if event[0] != "record":
+                sys.stderr.write("[capture] bad frame: %s\n" % event[1])
+                continue
+
+            kind, payload = event[1], event[2]
+            if kind == TELEMETRY_CAPTURE_BEGIN:
+                current = screen.begin(payload)
+            elif kind == TELEMETRY_CAPTURE_TILE and current is not None:
+                if not screen.apply_tile(payload):
+                    sys.stderr.write("[capture] truncated tile in frame %d\n" % current)
+            elif kind == TELEMETRY_CAPTURE_END and current is not None:
+                frame_id, sent, total, nbytes, duration = CAPTURE_END.unpack_from(payload)
+                if not screen.have_keyframe:
+                    sys.stderr.write("[capture] frame %d before first keyframe, skipped\n" % frame_id)
+                    continue
+                path = os.path.join(args.output, "frame_%05d.png" % frame_id)
+                write_png(path, screen.width, screen.height, screen.rgb)
+                written.append(path)
+                print("%s: %d/%d tiles, %d bytes, %d us" % (path, sent, total, nbytes, duration), flush=True)
+                current = None
+    except KeyboardInterrupt:
+        pass
+
+    if args.video and written:
+        if shutil.which("ffmpeg") is None:
+            sys.exit("ffmpeg not found; PNG frames are in %s" % args.output)
+        listing = os.path.join(args.output, "frames.txt")
+        with open(listing, "w") as f:
+            for path in written:
+                f.write("file '%s'\nduration %f\n" % (os.path.abspath(path), 1.0 / args.fps))
+        subprocess.check_call(["ffmpeg", "-y", "-loglevel", "error", "-f", "concat", "-safe", "0",
+                               "-i", listing, "-pix_fmt", "yuv420p", args.video])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,73 @@
+"""Minimal little-endian ELF32 reader for kernel.elf (no pyelftools needed)."""
+
+import struct
+
+
+class Elf32:
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1 or self.data[5] != 1:
+            raise ValueError("%s is not a little-endian ELF32 file" % path)
+
+        (self.shoff,) = struct.unpack_from("<I", self.data, 0x20)
+        self.shentsize, self.shnum, self.shstrndx = struct.unpack_from("<HHH", self.data, 0x2E)
+
+        self.sections = {}
+        headers = [struct.unpack_from("<IIIIIIIIII", self.data, self.shoff + i * self.shentsize)
+                   for i in range(self.shnum)]
+        names = headers[self.shstrndx]
+        for hdr in headers:
+            name = self._cstring(names[4] + hdr[0])
+            self.sections[name] = {"type": hdr[1], "addr": hdr[3], "offset": hdr[4],
+                                   "size": hdr[5], "link": hdr[6], "entsize": hdr[9]}
+        self._headers = headers
+
+    def _cstring(self, offset):
+        end = self.data.index(b"\0", offset)
+        return self.data[offset:end].decode("ascii", "replace")
+
+    def section(self, name):
+        """Return (load address, bytes) of a section, or None if absent."""
+        sec = self.sections.get(name)
+        if sec is None:
+            return None
+        return sec["addr"], self.data[sec["offset"]:sec["offset"] + sec["size"]]
+
+    def string_at(self, section_name, addr):
+        """Read a NUL-terminated string at a load address inside a section."""
+        found = self.section(section_name)
+        if found is None:
+            return None
+        base, data = found
+        if not base <= addr < base + len(data):
+            return None
+        end = data.find(b"\0", addr - base)
+        return data[addr - base:end if end >= 0 else None].decode("ascii", "replace")
+
+    def symbols(self):
+        """Return sorted (address, size, name) for code symbols in .symtab.
+
+        Functions and untyped labels (hand-written assembly) are included;
+        ARM mapping symbols ($a, $d, $t) are skipped.
+        """
+        symtab = self.sections.get(".symtab")
+        if symtab is None:
+            return []
+        strtab = self._headers[symtab["link"]]
+        text = self.sections.get(".text")
+
+        result = []
+        for offset in range(symtab["offset"], symtab["offset"] + symtab["size"], 16):
+            name_off, value, size, info, _other, shndx = struct.unpack_from("<IIIBBH", self.data, offset)
+            kind = info & 0xF
+            if kind not in (0, 2) or shndx == 0 or name_off == 0:  # STT_NOTYPE, STT_FUNC
+                continue
+            name = self._cstring(strtab[4] + name_off)
+            if name.startswith("$"):
+                continue
+            if text is not None and not text["addr"] <= value < text["addr"] + text["size"]:
+                continue
+            result.append((value & ~1, size, name))
+        result.sort()
+        return result
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Format deferred log records (src/log.c) on the host.
+
+Log call sites only record the address of their format string plus raw
+arguments. This tool looks the strings up in the .logstr section of the
+kernel.elf that produced the stream.
+
+Usage:
+    tools/logdecode.py kernel.elf /dev/ttyUSB0
+    tools/logdecode.py kernel.elf session.bin
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+import telemetry
+from elf32 import Elf32
+
+TELEMETRY_LOG = 0x05
+LOG_ENTRY = struct.Struct("<IIHBB4I")
+LEVEL_TAGS = "DIWE"
+
+CONVERSION = re.compile(r"%([duxc%])")
+
+
+def format_message(fmt, args):
+    values = iter(args)
+
+    def convert(match):
+        kind = match.group(1)
+        if kind == "%":
+            return "%"
+        value = next(values, 0)
+        if kind == "d":
+            return str(value - (1 << 32) if value & 0x80000000 else value)
+        if kind == "u":
+            return str(value)
+        if kind == "x":
+            return "%x" % value
+        return chr(value & 0xFF)
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="kernel.elf matching the running image")
+    parser.add_argument("source", help="serial device, file, or '-' for stdin")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    elf = Elf32(args.elf)
+    if elf.section(".logstr") is None:
+        sys.exit("%s has no .logstr section" % args.elf)
+
+    expected = None
+    try:
+        for event in telemetry.read_events(telemetry.open_stream(args.source, args.baud)):
+            if event[0] == "text":
+                sys.stdout.write(event[1].decode("ascii", "replace"))
+                continue
+            if event[0] != "record" or event[1] != TELEMETRY_LOG:
+                continue
+
+            fmt_addr, timestamp, seq, level, nargs, *raw = LOG_ENTRY.unpack_from(event[2])
+            if expected is not None and seq != expected:
+                print("[log] %d entries lost" % ((seq - expected) & 0xFFFF))
+            expected = (seq + 1) & 0xFFFF
+
+            fmt = elf.string_at(".logstr", fmt_addr)
+            if fmt is None:
+                fmt = "<unknown format 0x%08x>" % fmt_addr
+            tag = LEVEL_TAGS[level] if level < len(LEVEL_TAGS) else "?"
+            print("[%s %d] %s" % (tag, timestamp, format_message(fmt, raw[:nargs])), flush=True)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
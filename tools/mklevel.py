@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Compile an ASCII level (levels/*.txt) into the binary format of src/level.c.
+
+Level text: 30 rows of 40 cells, '#' for a wall and '.' (or space) for
+floor. The spawn is one of '>' '<' '^' 'v': the head cell and the initial
+direction; the two cells behind it must be floor. Lines starting with '!'
+are directives: '!name <text>' (up to 15 characters) and '!wrap' to make
+the snake leave one edge and come back on the opposite one.
+
+Binary layout, little-endian:
+    0  magic 'SLV1'
+    4  u16 total size, padded to a multiple of 4
+    6  u8 width, u8 height
+    8  u8 spawn x, u8 spawn y, u8 direction (0 up 1 down 2 left 3 right), u8 flags
+   12  name, 16 bytes NUL padded
+   28  u16 RLE length, u16 wall count
+   32  RLE: one byte per run, bit 7 = wall, bits 0-6 = length - 1
+
+Usage:
+    tools/mklevel.py levels/pillars.txt -o build/levels/pillars.lvl
+"""
+
+import argparse
+import struct
+import sys
+
+WIDTH = 40
+HEIGHT = 30
+MAGIC = b"SLV1"
+HEADER = struct.Struct("<4sHBBBBBB16sHH")
+FLAG_WRAP = 0x01
+MAX_RUN = 128
+
+# Spawn character -> (direction, step from the head towards the body)
+SPAWNS = {"^": (0, (0, 1)), "v": (1, (0, -1)), "<": (2, (1, 0)), ">": (3, (-1, 0))}
+
+
+def parse(path):
+    name = ""
+    flags = 0
+    rows = []
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            line = line.rstrip("\r\n")
+            if line.startswith("!"):
+                key, _, value = line[1:].partition(" ")
+                if key == "name":
+                    name = value.strip()
+                elif key == "wrap":
+                    flags |= FLAG_WRAP
+                else:
+                    raise ValueError("%s:%d: unknown directive '%s'" % (path, number, key))
+                continue
+            if not line and not rows:
+                continue
+            rows.append((number, line))
+
+    while rows and not rows[-1][1]:
+        rows.pop()
+    if len(rows) != HEIGHT:
+        raise ValueError("%s: %d rows, expected %d" % (path, len(rows), HEIGHT))
+    if len(name.encode("ascii")) > 15:
+        raise ValueError("%s: name longer than 15 characters" % path)
+
+    walls = []
+    spawn = None
+    for y, (number, line) in enumerate(rows):
+        if len(line.rstrip()) > WIDTH:
+            raise ValueError("%s:%d: row wider than %d" % (path, number, WIDTH))
+        line = line.ljust(WIDTH)
+        for x, cell in enumerate(line):
+            if cell == "#":
+                walls.append(True)
+            elif cell in ". ":
+                walls.append(False)
+            elif cell in SPAWNS:
+                if spawn:
+                    raise ValueError("%s:%d: second spawn" % (path, number))
+                spawn = (x, y, cell)
+                walls.append(False)
+            else:
+                raise ValueError("%s:%d: unknown cell '%s'" % (path, number, cell))
+
+    if not spawn:
+        raise ValueError("%s: no spawn ('>' '<' '^' 'v')" % path)
+    x, y, cell = spawn
+    direction, (dx, dy) = SPAWNS[cell]
+    for i in (1, 2):
+        bx, by = x + dx * i, y + dy * i
+        if not (0 <= bx < WIDTH and 0 <= by < HEIGHT) or walls[by * WIDTH + bx]:
+            raise ValueError("%s: no room for the body behind the spawn" % path)
+
+    return name, flags, (x, y, direction), walls
+
+
+def encode_runs(walls):
+    out = bytearray()
+    i = 0
+    while i < len(walls):
+        value = walls[i]
+        run = 1
+        while i + run < len(walls) and walls[i + run] == value and run < MAX_RUN:
+            run += 1
+        out.append((0x80 if value else 0) | (run - 1))
+        i += run
+    return bytes(out)
+
+
+def build(name, flags, spawn, walls):
+    rle = encode_runs(walls)
+    size = (HEADER.size + len(rle) + 3) & ~3
+    header = HEADER.pack(MAGIC, size, WIDTH, HEIGHT, spawn[0], spawn[1], spawn[2], flags,
+                         name.encode("ascii"), len(rle), sum(walls))
+    return (header + rle).ljust(size, b"\0")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("level", help="ASCII level file")
+    parser.add_argument("-o", "--output", required=True, help="binary level to write")
+    args = parser.parse_args()
+
+    try:
+        data = build(*parse(args.level))
+    except ValueError as error:
+        sys.exit("mklevel: %s" % error)
+
+    with open(args.output, "wb") as f:
+        f.write(data)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+"""End-to-end performance check: boot kernel.img on QEMU raspi2b and play.
+
+Boots the kernel with the serial port on a pipe, enables binary telemetry
+from the console, feeds a scripted WASD sequence, collects per-frame
+timing (TELEMETRY_FRAME_STATS) and the final console counters, then
+checks the results against thresholds. Exits 1 if any is crossed.
+
+Usage:
+    make perf-e2e
+    tools/perf_e2e.py --kernel kernel.img --script "s:4 d:6 w:8" --json perf.json
+    tools/perf_e2e.py --max draw_p95_us=20000 --max late_frames=5
+
+Script steps are KEY:FRAMES - send KEY, then wait for FRAMES frames.
+"""
+
+import argparse
+import json
+import queue
+import subprocess
+import sys
+import threading
+import time
+
+import telemetry
+
+ESC = b"\x1b"
+
+# Loops around the middle of the grid without reaching a wall
+DEFAULT_SCRIPT = "s:4 d:6 w:8 a:10 s:8 d:6 w:4 d:3"
+
+# Generous limits: QEMU is not cycle accurate, these catch regressions of
+# the order of "something became quadratic", not a few percent
+DEFAULT_LIMITS = {
+    "update_p95_us": 20000,
+    "draw_p95_us": 60000,
+    "draw_max_us": 250000,
+    "frame_period_p95_us": 150000,
+    "late_frames": 10,
+    "tx_dropped": 0,
+    "telemetry_errors": 0,
+}
+DEFAULT_MINIMUMS = {
+    "frames": 40,
+}
+
+
+def percentile(values, pct):
+    if not values:
+        return 0
+    ordered = sorted(values)
+    index = min(len(ordered) - 1, int(round(pct / 100.0 * (len(ordered) - 1))))
+    return ordered[index]
+
+
+class Session:
+    """QEMU process plus a reader thread decoding its serial output."""
+
+    def __init__(self, qemu, kernel, extra_args):
+        cmd = [qemu, "-M", "raspi2b", "-kernel", kernel, "-serial", "stdio",
+               "-display", "none", "-monitor", "none"] + extra_args
+        self.proc = subprocess.Popen(cmd, stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+        self.events = queue.Queue()
+        self.text = []
+        self.frames = []
+        self.errors = 0
+        self.reader = threading.Thread(target=self._read, daemon=True)
+        self.reader.start()
+
+    def _read(self):
+        for event in telemetry.read_events(self.proc.stdout):
+            self.events.put(event)
+        self.events.put(None)
+
+    def send(self, data):
+        self.proc.stdin.write(data)
+        self.proc.stdin.flush()
+
+    def command(self, line):
+        self.send(ESC + line.encode("ascii") + b"\r" + ESC)
+
+    def pump(self, timeout):
+        """Process events for up to 'timeout' seconds; False once QEMU exits."""
+        deadline = time.monotonic() + timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return True
+            try:
+                event = self.events.get(timeout=remaining)
+            except queue.Empty:
+                return True
+            if event is None:
+                return False
+            if event[0] == "text":
+                self.text.append(event[1].decode("ascii", "replace"))
+            elif event[0] == "error":
+                self.errors += 1
+            elif event[1] == telemetry.TELEMETRY_FRAME_STATS:
+                self.frames.append(telemetry.parse_frame_stats(event[2]))
+
+    def wait_for_text(self, needle, timeout):
+        deadline = time.monotonic() + timeout
+        while needle not in "".join(self.text):
+            if time.monotonic() > deadline or not self.pump(0.1):
+                return False
+        return True
+
+    def wait_for_frames(self, count, timeout):
+        target = len(self.frames) + count
+        deadline = time.monotonic() + timeout
+        while len(self.frames) < target:
+            if time.monotonic() > deadline or not self.pump(0.1):
+                return False
+        return True
+
+    def close(self):
+        self.proc.kill()
+        self.proc.wait()
+
+
+def parse_script(script):
+    steps = []
+    for step in script.split():
+        key, _, frames = step.partition(":")
+        if len(key) != 1:
+            raise ValueError("bad script step %r" % step)
+        steps.append((key.encode("ascii"), int(frames or 1)))
+    return steps
+
+
+def parse_limits(pairs, defaults):
+    limits = dict(defaults)
+    for pair in pairs or []:
+        name, _, value = pair.partition("=")
+        limits[name] = float(value)
+    return limits
+
+
+def summarize(session, counters):
+    frames = session.frames
+    update = [f["update_us"] for f in frames]
+    draw = [f["draw_us"] for f in frames]
+    periods = [b["timestamp_us"] - a["timestamp_us"] for a, b in zip(frames, frames[1:])]
+    nominal = percentile(periods, 50)
+    last = frames[-1] if frames else {}
+
+    return {
+        "frames": len(frames),
+        "update_p50_us": percentile(update, 50),
+        "update_p95_us": percentile(update, 95),
+        "update_max_us": max(update, default=0),
+        "draw_p50_us": percentile(draw, 50),
+        "draw_p95_us": percentile(draw, 95),
+        "draw_max_us": max(draw, default=0),
+        "frame_period_p50_us": nominal,
+        "frame_period_p95_us": percentile(periods, 95),
+        "late_frames": sum(1 for p in periods if nominal and p > nominal * 3 // 2),
+        "tx_dropped": last.get("tx_dropped", 0),
+        "telemetry_errors": session.errors,
+        "final_score": last.get("score", 0),
+        "final_length": last.get("length", 0),
+        "game_over": bool(last.get("flags", 0) & telemetry.FLAG_GAME_OVER),
+        "console": counters,
+    }
+
+
+def parse_counters(text):
+    """Pick 'name: value' lines out of the 'stats' command output."""
+    counters = {}
+    for line in text.splitlines():
+        name, sep, value = line.partition(":")
+        if sep and value.strip().isdigit():
+            counters[name.strip()] = int(value.strip())
+    return counters
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--kernel", default="kernel.img")
+    parser.add_argument("--qemu", default="qemu-system-arm")
+    parser.add_argument("--script", default=DEFAULT_SCRIPT, help="KEY:FRAMES steps")
+    parser.add_argument("--repeat", type=int, default=2, help="play the script this many times")
+    parser.add_argument("--boot-timeout", type=float, default=30.0)
+    parser.add_argument("--frame-timeout", type=float, default=10.0,
+                        help="seconds to wait for each step's frames")
+    parser.add_argument("--max", action="append", metavar="NAME=VALUE",
+                        help="override an upper limit (e.g. draw_p95_us=20000)")
+    parser.add_argument("--min", action="append", metavar="NAME=VALUE",
+                        help="override a lower limit (e.g. frames=100)")
+    parser.add_argument("--json", help="write the summary here")
+    parser.add_argument("--verbose", action="store_true", help="echo console output")
+    parser.add_argument("qemu_args", nargs="*", help="extra QEMU arguments (after --)")
+    args = parser.parse_args()
+
+    steps = parse_script(args.script) * args.repeat
+    maximums = parse_limits(args.max, DEFAULT_LIMITS)
+    minimums = parse_limits(args.min, DEFAULT_MINIMUMS)
+
+    session = Session(args.qemu, args.kernel, args.qemu_args)
+    try:
+        if not session.wait_for_text("Game starting!", args.boot_timeout):
+            sys.exit("kernel did not reach the game loop within %.0fs" % args.boot_timeout)
+
+        session.command("telemetry on")
+        if not session.wait_for_frames(2, args.frame_timeout):
+            sys.exit("no telemetry frames received")
+
+        for key, frames in steps:
+            session.send(key)
+            if not session.wait_for_frames(frames, args.frame_timeout):
+                sys.exit("timed out waiting for frames after %r" % key.decode())
+
+        session.command("telemetry off")
+        mark = len(session.text)
+        session.command("stats")
+        session.wait_for_text("log lost", args.frame_timeout)
+        session.pump(0.5)
+        counters = parse_counters("".join(session.text[mark:]))
+    finally:
+        if args.verbose:
+            sys.stderr.write("".join(session.text))
+        session.close()
+
+    summary = summarize(session, counters)
+    failures = []
+    for name, limit in maximums.items():
+        if summary.get(name, 0) > limit:
+            failures.append("%s = %s > %s" % (name, summary[name], limit))
+    for name, limit in minimums.items():
+        if summary.get(name, 0) < limit:
+            failures.append("%s = %s < %s" % (name, summary[name], limit))
+    summary["failures"] = failures
+
+    for name, value in summary.items():
+        if name not in ("console", "failures"):
+            print("%-22s %s" % (name, value))
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(summary, f, indent=2)
+
+    if failures:
+        print("FAIL")
+        for failure in failures:
+            print("  " + failure)
+        sys.exit(1)
+    print("PASS")
+
+
+if __name__ == "__main__":
+    main()
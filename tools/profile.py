@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Flat profile from the kernel's PC sampler (src/sampler.c).
+
+Reads the UART stream (serial device, file or '-') until a complete
+'sample dump' has been received, then attributes each sample bucket to
+the enclosing symbol in kernel.elf.
+
+Usage:
+    tools/profile.py /dev/ttyUSB0 --elf kernel.elf
+    tools/profile.py session.bin --elf kernel.elf --buckets
+"""
+
+import argparse
+import bisect
+import struct
+import sys
+
+import telemetry
+from elf32 import Elf32
+
+TELEMETRY_PROFILE_HEADER = 0x06
+TELEMETRY_PROFILE_SAMPLES = 0x07
+
+PROFILE_HEADER = struct.Struct("<IIIIIII")
+PROFILE_ENTRY = struct.Struct("<II")
+
+
+def read_dump(stream):
+    """Return (header dict, [(address, count)]) for the first complete dump."""
+    header = None
+    entries = []
+    for event in telemetry.read_events(stream):
+        if event[0] == "text":
+            sys.stderr.write(event[1].decode("ascii", "replace"))
+            continue
+        if event[0] != "record":
+            sys.stderr.write("[profile] bad frame: %s\n" % event[1])
+            continue
+
+        kind, payload = event[1], event[2]
+        if kind == TELEMETRY_PROFILE_HEADER:
+            fields = PROFILE_HEADER.unpack_from(payload)
+            header = dict(zip(("text_start", "text_end", "bucket_shift", "period_us",
+                               "samples", "outside", "entries"), fields))
+            entries = []
+        elif kind == TELEMETRY_PROFILE_SAMPLES and header is not None:
+            entries += PROFILE_ENTRY.iter_unpack(payload)
+        else:
+            continue
+
+        if header is not None and len(entries) >= header["entries"]:
+            return header, entries
+    return header, entries
+
+
+class Symbolizer:
+    def __init__(self, symbols):
+        self.symbols = symbols
+        self.addresses = [sym[0] for sym in symbols]
+
+    def lookup(self, address):
+        i = bisect.bisect_right(self.addresses, address) - 1
+        if i < 0:
+            return "??"
+        return self.symbols[i][2]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", help="serial device, file, or '-' for stdin")
+    parser.add_argument("--elf", default="kernel.elf", help="kernel ELF with symbols")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--buckets", action="store_true", help="also list the hottest raw buckets")
+    parser.add_argument("--limit", type=int, default=30, help="rows to print")
+    args = parser.parse_args()
+
+    symbolizer = Symbolizer(Elf32(args.elf).symbols())
+    try:
+        header, entries = read_dump(telemetry.open_stream(args.source, args.baud))
+    except KeyboardInterrupt:
+        header, entries = None, []
+    if header is None:
+        sys.exit("no profile dump found (run 'sample dump' on the console)")
+    if len(entries) < header["entries"]:
+        sys.stderr.write("[profile] incomplete dump: %d of %d buckets\n" % (len(entries), header["entries"]))
+
+    total = header["samples"] or 1
+    per_symbol = {}
+    for address, count in entries:
+        name = symbolizer.lookup(address)
+        per_symbol[name] = per_symbol.get(name, 0) + count
+    if header["outside"]:
+        per_symbol["<outside .text>"] = header["outside"]
+
+    print("%d samples every %d us, %d-byte buckets" % (header["samples"], header["period_us"],
+                                                       1 << header["bucket_shift"]))
+    print("%8s %7s  %s" % ("samples", "%", "symbol"))
+    ranked = sorted(per_symbol.items(), key=lambda item: -item[1])
+    for name, count in ranked[:args.limit]:
+        print("%8d %6.2f%%  %s" % (count, 100.0 * count / total, name))
+
+    if args.buckets:
+        print()
+        print("%8s %7s  %s" % ("samples", "%", "bucket"))
+        for address, count in sorted(entries, key=lambda entry: -entry[1])[:args.limit]:
+            print("%8d %6.2f%%  0x%08x %s" % (count, 100.0 * count / total, address,
+                                              symbolizer.lookup(address)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+"""Play back the games recorded in REPLAYS.TXT (src/storage.c).
+
+Each line is "<seed> <level> <score> <steps> <turns...>", a turn being
+"<step><U|D|L|R>": the direction taken before logic step <step>. The
+level is matched against the '!name' of levels/*.txt (spaces written as
+underscores). Food placement is re-run from the seed with the same
+xorshift generator as src/snake.c, so a complete replay must reach the
+recorded score and end on its last step. A line ending in " +<n>" lost
+<n> turns on the target and is only followed up to its last turn.
+
+Usage:
+    tools/replay.py REPLAYS.TXT
+    tools/replay.py REPLAYS.TXT --levels levels --line 3 --board
+"""
+
+import argparse
+import glob
+import os
+import sys
+
+import mklevel
+
+WIDTH = mklevel.WIDTH
+HEIGHT = mklevel.HEIGHT
+DIRECTIONS = "UDLR"
+
+# Direction (src/snake.h direction_t) -> head movement
+MOVES = ((0, -1), (0, 1), (-1, 0), (1, 0))
+
+
+def load_levels(directory):
+    levels = {}
+    for path in sorted(glob.glob(os.path.join(directory, "*.txt"))):
+        name, flags, spawn, walls = mklevel.parse(path)
+        levels[name.replace(" ", "_")] = (flags, spawn, walls)
+    return levels
+
+
+class Game:
+    """snake_init(), snake_update() and snake_place_food() without the I/O."""
+
+    def __init__(self, level, seed):
+        flags, (x, y, direction), self.walls = level
+        self.wraps = bool(flags & mklevel.FLAG_WRAP)
+        self.rng = seed
+        self.direction = direction
+        dx, dy = MOVES[direction]
+        self.body = [(x - dx * i, y - dy * i) for i in range(3)]
+        self.score = 0
+        self.over = False
+        self.steps = 0
+        self.place_food()
+
+    def random_next(self):
+        state = self.rng
+        state ^= (state << 13) & 0xFFFFFFFF
+        state ^= state >> 17
+        state ^= (state << 5) & 0xFFFFFFFF
+        self.rng = state
+        return state
+
+    def is_wall(self, x, y):
+        return self.walls[y * WIDTH + x]
+
+    def occupied(self, cell):
+        return self.is_wall(*cell) or cell in self.body
+
+    def place_food(self):
+        for _ in range(100):
+            self.food = (self.random_next() % WIDTH, self.random_next() % HEIGHT)
+            if not self.occupied(self.food):
+                return
+        # The target draws once more before giving up, then scans for the
+        # first free cell (ending on the last cell if there is none)
+        self.random_next()
+        self.random_next()
+        for i in range(WIDTH * HEIGHT):
+            self.food = (i % WIDTH, i // WIDTH)
+            if not self.occupied(self.food):
+                return
+
+    def step(self, direction=None):
+        if direction is not None:
+            self.direction = direction
+        self.steps += 1
+
+        dx, dy = MOVES[self.direction]
+        x, y = self.body[0][0] + dx, self.body[0][1] + dy
+        if self.wraps:
+            x, y = x % WIDTH, y % HEIGHT
+        tail = self.body[-1]
+        self.body = [(x, y)] + self.body[:-1]
+
+        if not (0 <= x < WIDTH and 0 <= y < HEIGHT) or self.is_wall(x, y):
+            self.over = True
+        elif (x, y) in self.body[1:]:
+            self.over = True
+        elif (x, y) == self.food:
+            self.score += 10
+            self.body.append(tail)
+            self.place_food()
+
+    def board(self):
+        rows = []
+        for y in range(HEIGHT):
+            row = ""
+            for x in range(WIDTH):
+                if (x, y) == self.body[0]:
+                    row += "@"
+                elif (x, y) in self.body:
+                    row += "o"
+                elif (x, y) == self.food:
+                    row += "*"
+                else:
+                    row += "#" if self.is_wall(x, y) else "."
+            rows.append(row)
+        return "\n".join(rows)
+
+
+def parse_line(line):
+    fields = line.split()
+    if len(fields) < 4:
+        raise ValueError("expected '<seed> <level> <score> <steps> <turns...>'")
+    seed, level, score, steps = int(fields[0]), fields[1], int(fields[2]), int(fields[3])
+    turns = {}
+    truncated = 0
+    for field in fields[4:]:
+        if field.startswith("+"):
+            truncated = int(field[1:])
+        elif field[-1] in DIRECTIONS:
+            turns[int(field[:-1])] = DIRECTIONS.index(field[-1])
+        else:
+            raise ValueError("bad turn '%s'" % field)
+    return seed, level, score, steps, turns, truncated
+
+
+def replay(levels, line):
+    """Return (game, error message or None) for one recorded game."""
+    seed, name, score, steps, turns, truncated = parse_line(line)
+    if name not in levels:
+        return None, "unknown level '%s'" % name
+    game = Game(levels[name], seed)
+
+    # A truncated record has no turns after its last one to follow
+    last = max(turns) + 1 if truncated and turns else steps
+    while game.steps < last and not game.over:
+        game.step(turns.get(game.steps))
+
+    if truncated:
+        if game.over and game.steps < last:
+            return game, "died on step %d before the last recorded turn" % game.steps
+        return game, None
+    if not game.over:
+        return game, "still alive after %d steps" % game.steps
+    if game.steps != steps:
+        return game, "died on step %d, recorded %d" % (game.steps, steps)
+    if game.score != score:
+        return game, "score %d, recorded %d" % (game.score, score)
+    return game, None
+
+
+def main():
+    default_levels = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "levels")
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("replays", help="REPLAYS.TXT copied off the card")
+    parser.add_argument("--levels", default=default_levels, help="directory of level .txt files")
+    parser.add_argument("--line", type=int, help="only play this line (1-based)")
+    parser.add_argument("--board", action="store_true", help="print the final board")
+    args = parser.parse_args()
+
+    try:
+        levels = load_levels(args.levels)
+    except ValueError as error:
+        sys.exit("replay: %s" % error)
+
+    failures = 0
+    with open(args.replays) as f:
+        for number, line in enumerate(f, 1):
+            if not line.strip() or (args.line and number != args.line):
+                continue
+            try:
+                game, error = replay(levels, line)
+            except ValueError as error_text:
+                game, error = None, str(error_text)
+            if error:
+                failures += 1
+                print("%d: FAIL %s" % (number, error))
+            else:
+                print("%d: ok score %d in %d steps" % (number, game.score, game.steps))
+            if args.board and game:
+                print(game.board())
+
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == "__main__":
+    main()
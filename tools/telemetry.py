@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""Host-side decoder for the Polisnake UART stream.
+
+The kernel multiplexes console text and binary telemetry on one PL011.
+Binary records are framed as 0x00, COBS(type, payload, crc16), 0x00;
+everything outside a frame is console text.
+
+Usage:
+    tools/telemetry.py /dev/ttyUSB0            # live from a serial port
+    tools/telemetry.py capture.bin --csv       # from a recorded stream
+    qemu-system-arm ... -serial stdio | tools/telemetry.py -
+
+Console text is echoed to stderr; decoded records go to stdout.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+# Record types (keep in sync with src/telemetry.h)
+TELEMETRY_FRAME_STATS = 0x01
+
+FRAME_STATS = struct.Struct("<IIIIIHHIII")
+FRAME_STATS_FIELDS = ("tick", "timestamp_us", "update_us", "draw_us", "score",
+                      "length", "flags", "irq_timer", "irq_uart", "tx_dropped")
+
+FLAG_GAME_OVER = 0x0001
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, matching crc16_update() in src/telemetry.c."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0:
+            raise ValueError("zero byte inside COBS block")
+        end = i + code
+        if end > len(data) + 1:
+            raise ValueError("truncated COBS block")
+        out += data[i + 1:end]
+        i = end
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+class StreamDecoder:
+    """Split a raw UART byte stream into console text and records.
+
+    feed() yields ("text", bytes), ("record", type, payload) and
+    ("error", message) events in stream order.
+    """
+
+    def __init__(self):
+        self.in_frame = False
+        self.buf = bytearray()
+        self.frames = 0
+        self.errors = 0
+
+    def feed(self, data):
+        for byte in data:
+            if byte == 0:
+                if self.in_frame and not self.buf:
+                    # Back-to-back delimiters: the second one opens the frame
+                    continue
+                if self.in_frame:
+                    event = self._finish_frame()
+                    if event is not None:
+                        yield event
+                    self.in_frame = False
+                else:
+                    if self.buf:
+                        yield ("text", bytes(self.buf))
+                    self.in_frame = True
+                self.buf.clear()
+            else:
+                self.buf.append(byte)
+                if not self.in_frame and byte == 0x0A:
+                    yield ("text", bytes(self.buf))
+                    self.buf.clear()
+
+    def flush(self):
+        if not self.in_frame and self.buf:
+            yield ("text", bytes(self.buf))
+            self.buf.clear()
+
+    def _finish_frame(self):
+        try:
+            raw = cobs_decode(bytes(self.buf))
+        except ValueError as err:
+            self.errors += 1
+            return ("error", str(err))
+        if len(raw) < 3:
+            self.errors += 1
+            return ("error", "short frame")
+        body, crc = raw[:-2], raw[-2] | (raw[-1] << 8)
+        if crc16_ccitt(body) != crc:
+            self.errors += 1
+            return ("error", "CRC mismatch")
+        self.frames += 1
+        return ("record", body[0], body[1:])
+
+
+def parse_frame_stats(payload):
+    return dict(zip(FRAME_STATS_FIELDS, FRAME_STATS.unpack_from(payload)))
+
+
+def open_stream(path, baud):
+    """Open a file, '-' for stdin, or a serial device in raw mode."""
+    if path == "-":
+        return sys.stdin.buffer
+    fd = os.open(path, os.O_RDONLY | getattr(os, "O_NOCTTY", 0))
+    if os.isatty(fd):
+        import termios
+        import tty
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        speed = getattr(termios, "B%d" % baud)
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return os.fdopen(fd, "rb", buffering=0)
+
+
+def read_events(stream, chunk=4096):
+    decoder = StreamDecoder()
+    while True:
+        data = stream.read1(chunk) if hasattr(stream, "read1") else stream.read(chunk)
+        if not data:
+            break
+        yield from decoder.feed(data)
+    yield from decoder.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", help="serial device, file, or '-' for stdin")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--csv", action="store_true", help="print frame stats as CSV")
+    parser.add_argument("--quiet", action="store_true", help="do not echo console text")
+    args = parser.parse_args()
+
+    stream = open_stream(args.source, args.baud)
+    if args.csv:
+        print(",".join(FRAME_STATS_FIELDS), flush=True)
+
+    try:
+        for event in read_events(stream):
+            if event[0] == "text":
+                if not args.quiet:
+                    sys.stderr.write(event[1].decode("ascii", "replace"))
+                    sys.stderr.flush()
+            elif event[0] == "error":
+                sys.stderr.write("[telemetry] bad frame: %s\n" % event[1])
+            elif event[1] == TELEMETRY_FRAME_STATS:
+                stats = parse_frame_stats(event[2])
+                if args.csv:
+                    print(",".join(str(stats[f]) for f in FRAME_STATS_FIELDS), flush=True)
+                else:
+                    print("tick %(tick)6d  update %(update_us)6d us  draw %(draw_us)6d us  "
+                          "score %(score)4d  len %(length)4d  irq t/u %(irq_timer)d/%(irq_uart)d  "
+                          "drop %(tx_dropped)d" % stats, flush=True)
+            else:
+                print("record type 0x%02x, %d bytes" % (event[1], len(event[2])), flush=True)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()